@@ -526,7 +526,12 @@ void ScreenLive::EncodeVideo()
 			if (h264_encoder_.Encode(&bgra_image[0], width, height, bgra_image.size(), out_frame) > 0) {
 				if (out_frame.size() > 0) {
 					encoding_fps += 1;	// 帧率计数
-					PushVideo(&out_frame[0], out_frame.size(), timestamp);	// 推送数据
+					// 编码输出交给帧引用，最后一路输出释放后才析构，不拷贝
+					std::vector<uint8_t>* encoded = new std::vector<uint8_t>(std::move(out_frame));
+					uint32_t size = (uint32_t)encoded->size();
+					PushVideo(xop::AVFramePool::Instance().Wrap(encoded->data(), size, [encoded](uint8_t*) {
+						delete encoded;
+					}, "ScreenLive"), size, timestamp);	// 推送数据
 				}
 			}
 		}
@@ -587,7 +592,10 @@ void ScreenLive::EncodeAudio()
 			if (pkt_ptr) {
 				// 生成时间戳并推送数据
 				uint32_t timestamp = xop::AACSource::GetTimestamp(samplerate);
-				PushAudio(pkt_ptr->data, pkt_ptr->size, timestamp);
+				uint32_t size = (uint32_t)pkt_ptr->size;
+				PushAudio(xop::AVFramePool::Instance().Wrap(pkt_ptr->data, size, [pkt_ptr](uint8_t*) mutable {
+					pkt_ptr.reset();
+				}, "ScreenLive"), size, timestamp);
 			}
 		}
 		else {
@@ -597,7 +605,7 @@ void ScreenLive::EncodeAudio()
 	}
 }
 
-void ScreenLive::PushVideo(const uint8_t* data, uint32_t size, uint32_t timestamp)
+void ScreenLive::PushVideo(std::shared_ptr<uint8_t> data, uint32_t size, uint32_t timestamp)
 {
 	/*
 	1. H.264 起始码详解
@@ -631,11 +639,10 @@ void ScreenLive::PushVideo(const uint8_t* data, uint32_t size, uint32_t timestam
 			NALU 数据：67 42 80 29 ...
 	*/
 
-	xop::AVFrame video_frame(size);
-	video_frame.size = size - 4; /* -4 去掉H.264起始码 */
-	video_frame.type = IsKeyFrame(data, size) ? xop::VIDEO_FRAME_I : xop::VIDEO_FRAME_P;
+	/* -4 去掉H.264起始码：与 data 共享同一块内存，只偏移指针 */
+	xop::AVFrame video_frame(std::shared_ptr<uint8_t>(data, data.get() + 4), size - 4);
+	video_frame.type = IsKeyFrame(data.get(), size) ? xop::VIDEO_FRAME_I : xop::VIDEO_FRAME_P;
 	video_frame.timestamp = timestamp;
-	memcpy(video_frame.buffer.get(), data + 4, size - 4);
 
 	if (size > 0) {
 		std::lock_guard<std::mutex> locker(mutex_);
@@ -657,13 +664,11 @@ void ScreenLive::PushVideo(const uint8_t* data, uint32_t size, uint32_t timestam
 	}
 }
 
-void ScreenLive::PushAudio(const uint8_t* data, uint32_t size, uint32_t timestamp)
+void ScreenLive::PushAudio(std::shared_ptr<uint8_t> data, uint32_t size, uint32_t timestamp)
 {
-	xop::AVFrame audio_frame(size);
+	xop::AVFrame audio_frame(std::move(data), size);
 	audio_frame.timestamp = timestamp;
 	audio_frame.type = xop::AUDIO_FRAME;
-	audio_frame.size = size;
-	memcpy(audio_frame.buffer.get(), data, size);
 
 	if(size > 0){
 		std::lock_guard<std::mutex> locker(mutex_);
@@ -94,8 +94,9 @@ private:
 	
 	void EncodeVideo();
 	void EncodeAudio();
-	void PushVideo(const uint8_t* data, uint32_t size, uint32_t timestamp);
-	void PushAudio(const uint8_t* data, uint32_t size, uint32_t timestamp);
+	// data 持有编码输出（通常由 AVFrame::Wrap/AVFramePool::Wrap 引用编码器的缓冲区），各路输出共享，不再拷贝
+	void PushVideo(std::shared_ptr<uint8_t> data, uint32_t size, uint32_t timestamp);
+	void PushAudio(std::shared_ptr<uint8_t> data, uint32_t size, uint32_t timestamp);
 	bool IsKeyFrame(const uint8_t* data, uint32_t size);
 
 	bool is_initialized_ = false;
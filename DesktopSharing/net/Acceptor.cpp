@@ -5,8 +5,9 @@
 
 using namespace xop;
 
-Acceptor::Acceptor(EventLoop* eventLoop)
+Acceptor::Acceptor(EventLoop* eventLoop, TaskScheduler* task_scheduler)
     : event_loop_(eventLoop)
+    , task_scheduler_(task_scheduler)
     , tcp_socket_(new TcpSocket)
 {	
 	
@@ -49,7 +50,11 @@ int Acceptor::Listen(std::string ip, uint16_t port) {
     channel_ptr_.reset(new Channel(sockfd)); // Ѽ sockfd  Channel 󣬸ֵ Acceptor е Channel ͵ָԱ
     channel_ptr_->SetReadCallback([this]() { this->OnAccept(); }); //  sockfd ж¼¼ʱ򣬵 void Acceptor::OnAccept() µĿͻ
     channel_ptr_->EnableReading();
-    // select
+    // selectУƬʱֱӼ
+    if (task_scheduler_) {
+        task_scheduler_->UpdateChannel(channel_ptr_);
+        return 0;
+    }
     event_loop_->UpdateChannel(channel_ptr_); // event_loop_  Acceptor  EventLoop* ͵ĳԱEventLoop װ߳еڵдģ
    
     /*
@@ -73,22 +78,34 @@ void Acceptor::Close() {
     std::lock_guard<std::mutex> locker(mutex_);
 
     if (tcp_socket_->GetSocket() > 0) {
-        event_loop_->RemoveChannel(channel_ptr_); // ע¼
+        if (task_scheduler_) {
+            task_scheduler_->RemoveChannel(channel_ptr_);
+        }
+        else {
+            event_loop_->RemoveChannel(channel_ptr_); // ע¼
+        }
         tcp_socket_->Close();                     // ر׽
     }
 }
 
 /*
-ܣ׽ֿɶʱӣ accept() ӡ
+ܣ׽ֿɶʱӣѭ accept() ֱѹΪգEAGAIN
+һξ֪ͨһӣӷ籩ʱÿһ epoll_waitشģʽҲ
 ̰߳ȫͨ mutex_  tcp_socket_  Accept() 
 ص˻ص׽ִݸϲ㣻ֱӹرա
 */
 void Acceptor::OnAccept() {
     std::lock_guard<std::mutex> locker(mutex_);
 
-    // tcp_socket_  Acceptor  TcpSocket ͵ĳԱĳԱ sockfd_  int Acceptor::Listen(std::string ip, uint16_t port) ѾΪ׽
-    SOCKET socket = tcp_socket_->Accept();
-    if (socket > 0) {
+    uint32_t accepts = 0;
+    while (true) {
+        // tcp_socket_  Acceptor  TcpSocket ͵ĳԱĳԱ sockfd_  int Acceptor::Listen(std::string ip, uint16_t port) ѾΪ׽
+        SOCKET socket = tcp_socket_->Accept();
+        if (socket <= 0) {
+            break;                            // EAGAIN EMFILEʱȴһ֪ͨ
+        }
+
+        accepts += 1;
         if (new_connection_callback_) {
             new_connection_callback_(socket); // ׽
         }
@@ -96,5 +113,10 @@ void Acceptor::OnAccept() {
             SocketUtil::Close(socket);        // ޻صر
         }
     }
+
+    TaskScheduler* task_scheduler = task_scheduler_ ? task_scheduler_ : event_loop_->GetTaskScheduler(0).get();
+    if (task_scheduler) {
+        task_scheduler->RecordAccept(accepts);
+    }
 }
 
@@ -24,11 +24,13 @@ namespace xop
 typedef std::function<void(SOCKET)> NewConnectionCallback;
 
 class EventLoop;
+class TaskScheduler;
 
 class Acceptor
 {
 public:	
-	Acceptor(EventLoop* eventLoop);
+	// task_scheduler ǿʱ׽עᵽõƬעᵽ EventLoop ĵһ
+	Acceptor(EventLoop* eventLoop, TaskScheduler* task_scheduler = nullptr);
 	virtual ~Acceptor();
 
 	// ӻص
@@ -40,11 +42,15 @@ public:
 	// رռ׽֣ EventLoop ע¼
 	void Close();
 
+	SOCKET GetSocket() const
+	{ return tcp_socket_->GetSocket(); }
+
 private:
 	// 󣬴ص
 	void OnAccept();
 
 	EventLoop* event_loop_ = nullptr;				// ָ¼ѭָ룬ע/ע¼
+	TaskScheduler* task_scheduler_ = nullptr;		// Ƭʱ׽ĵΪձʾʹ event_loop_
 	std::mutex mutex_;								//  tcp_socket_  channel_ptr_ ̰߳ȫʡ
 	std::unique_ptr<TcpSocket> tcp_socket_;			// װ׽֣ڣԶͷԴ
 	ChannelPtr channel_ptr_;						// װ׽ֵ¼ɶ¼󶨻ص OnAccept()
@@ -0,0 +1,239 @@
+#ifndef XOP_BLOCKING_QUEUE_H
+#define XOP_BLOCKING_QUEUE_H
+
+/*
+BlockingQueue УRingBuffer  MpscQueueȴڱ̡߳Ƶɼ֮߳Ľӡ
+
+/ʱһ 32 λϵȴLinux futexWindows WaitOnAddressʹ mutex + condvar
+ȴȵǼ¼Уһֻ˵ǼʱŲѣ
+ûеȴʱ Push/Pop ֻȵײжһԭӶںˡ
+ߵײͬRingBuffer ֻһߣ߶ֻһߡ
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include "MpscQueue.h"
+#include "RingBuffer.h"
+
+#if defined(__linux) || defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(WIN32) || defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+namespace xop
+{
+
+// ŵĵȴ/ѣ futex ͬWait(seq) Ϊ seq ʱ˯ߡ
+class FutexEvent
+{
+public:
+	FutexEvent() : seq_(0), waiters_(0) {}
+
+	FutexEvent(const FutexEvent&) = delete;
+	FutexEvent& operator=(const FutexEvent&) = delete;
+
+	// ȴǰãǼΪȴ߲صǰţ֮¼ٵ Wait()  Cancel()
+	uint32_t Prepare()
+	{
+		waiters_.fetch_add(1, std::memory_order_seq_cst);
+		uint32_t seq = seq_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return seq;
+	}
+
+	// Ϊ seq ʱȴֱѻʱtimeout_ms < 0 ʾʱǰעȴߡ
+	void Wait(uint32_t seq, int timeout_ms)
+	{
+#if defined(__linux) || defined(__linux__)
+		struct timespec ts;
+		struct timespec* pts = nullptr;
+		if (timeout_ms >= 0) {
+			ts.tv_sec = timeout_ms / 1000;
+			ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+			pts = &ts;
+		}
+		syscall(SYS_futex, (uint32_t*)&seq_, FUTEX_WAIT_PRIVATE, seq, pts, nullptr, 0);
+#elif defined(WIN32) || defined(_WIN32)
+		::WaitOnAddress((volatile VOID*)&seq_, &seq, sizeof(seq), timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+#else
+		if (seq_.load(std::memory_order_acquire) == seq) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+#endif
+		waiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// ¼鷢㣬ٵȴ
+	void Cancel()
+	{
+		waiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// ıãеȴʱŲȫȴߡ
+	void Notify()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters_.load(std::memory_order_relaxed) > 0) {
+			seq_.fetch_add(1, std::memory_order_release);
+#if defined(__linux) || defined(__linux__)
+			syscall(SYS_futex, (uint32_t*)&seq_, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(WIN32) || defined(_WIN32)
+			::WakeByAddressAll((PVOID)&seq_);
+#endif
+		}
+	}
+
+private:
+	std::atomic<uint32_t> seq_;
+	std::atomic<uint32_t> waiters_;
+};
+
+template <typename T, template <typename> class Queue = MpscQueue>
+class BlockingQueue
+{
+public:
+	explicit BlockingQueue(size_t capacity)
+		: queue_((int)capacity), is_closed_(false)
+	{ }
+
+	BlockingQueue(const BlockingQueue&) = delete;
+	BlockingQueue& operator=(const BlockingQueue&) = delete;
+
+	// ȴѹرʱ false
+	template <typename F>
+	bool TryPush(F&& data)
+	{
+		if (is_closed_.load(std::memory_order_relaxed) || !queue_.Push(std::forward<F>(data))) {
+			return false;
+		}
+
+		not_empty_.Notify();
+		return true;
+	}
+
+	// ȴпʱ false
+	bool TryPop(T& data)
+	{
+		if (!queue_.Pop(data)) {
+			return false;
+		}
+
+		not_full_.Notify();
+		return true;
+	}
+
+	// ʱȴʱtimeout_ms >= 0йرʱ false
+	template <typename F>
+	bool Push(F&& data, int timeout_ms = -1)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (!is_closed_.load(std::memory_order_acquire)) {
+			if (queue_.Push(std::forward<F>(data))) {
+				not_empty_.Notify();
+				return true;
+			}
+
+			uint32_t seq = not_full_.Prepare();
+			if (is_closed_.load(std::memory_order_acquire) || queue_.Push(std::forward<F>(data))) {
+				not_full_.Cancel();
+				if (is_closed_.load(std::memory_order_acquire)) {
+					return false;
+				}
+				not_empty_.Notify();
+				return true;
+			}
+
+			int wait_ms = RemainingMsec(deadline, timeout_ms);
+			if (wait_ms == 0) {
+				not_full_.Cancel();
+				return false;
+			}
+			not_full_.Wait(seq, wait_ms);
+		}
+
+		return false;
+	}
+
+	// пʱȴʱѹرΪʱ false
+	bool Pop(T& data, int timeout_ms = -1)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (true) {
+			if (TryPop(data)) {
+				return true;
+			}
+
+			uint32_t seq = not_empty_.Prepare();
+			if (TryPop(data)) {
+				not_empty_.Cancel();
+				return true;
+			}
+
+			if (is_closed_.load(std::memory_order_acquire)) {
+				not_empty_.Cancel();
+				return false;
+			}
+
+			int wait_ms = RemainingMsec(deadline, timeout_ms);
+			if (wait_ms == 0) {
+				not_empty_.Cancel();
+				return false;
+			}
+			not_empty_.Wait(seq, wait_ms);
+		}
+	}
+
+	// رնУ֮ Push ʧܣPop ȡʣԪغ󷵻 falseеȴߡ
+	void Close()
+	{
+		is_closed_.store(true, std::memory_order_release);
+		not_empty_.Notify();
+		not_full_.Notify();
+	}
+
+	bool IsClosed() const
+	{ return is_closed_.load(std::memory_order_acquire); }
+
+	size_t Size() const
+	{ return queue_.Size(); }
+
+	bool IsEmpty() const
+	{ return queue_.IsEmpty(); }
+
+private:
+	// ʱ -1ѳʱ 0
+	static int RemainingMsec(std::chrono::steady_clock::time_point deadline, int timeout_ms)
+	{
+		if (timeout_ms < 0) {
+			return -1;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline) {
+			return 0;
+		}
+
+		int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+		return ms > 0 ? (int)ms : 1;
+	}
+
+	Queue<T> queue_;
+	std::atomic<bool> is_closed_;
+	FutexEvent not_empty_;
+	FutexEvent not_full_;
+};
+
+}
+
+#endif
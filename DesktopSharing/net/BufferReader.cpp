@@ -4,6 +4,14 @@
 #include "BufferReader.h"
 #include "Socket.h"
 #include <cstring>
+#include <cstdlib>
+#if defined(__linux) || defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
  
 using namespace xop;
 uint32_t xop::ReadUint32BE(char* data)
@@ -50,31 +58,185 @@ uint16_t xop::ReadUint16LE(char* data)
 
 const char BufferReader::kCRLF[] = "\r\n";
 
+/*
+ͬһ size ֽڵڴ棨memfdӳΣʧܷ nullptr
+*/
+static char* MapMirror(size_t size)
+{
+#if defined(__linux) || defined(__linux__)
+	int fd = (int)syscall(SYS_memfd_create, "xop-buffer-reader", MFD_CLOEXEC);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	char* addr = nullptr;
+	if (ftruncate(fd, size) == 0) {
+		// ȱ 2 * size ĵַռ䣬ٰӳ̶ڵλ
+		void* base = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base != MAP_FAILED) {
+			if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+				&& mmap((char*)base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+				addr = (char*)base;
+			}
+			else {
+				munmap(base, size * 2);
+			}
+		}
+	}
+
+	close(fd);
+	return addr;
+#else
+	return nullptr;
+#endif
+}
+
+static void UnmapMirror(char* addr, size_t size)
+{
+#if defined(__linux) || defined(__linux__)
+	munmap(addr, size * 2);
+#endif
+}
+
+/*
+ӳҪСҳСȡС size  2 ݡ
+*/
+static size_t GetMirrorSize(size_t size)
+{
+	size_t page_size = 4096;
+#if defined(__linux) || defined(__linux__)
+	long n = sysconf(_SC_PAGESIZE);
+	if (n > 0) {
+		page_size = (size_t)n;
+	}
+#endif
+
+	size_t capacity = page_size;
+	while (capacity < size) {
+		capacity *= 2;
+	}
+	return capacity;
+}
+
 BufferReader::BufferReader(uint32_t initial_size)
+	: read_size_(kMinReadSize)
 {
-	buffer_.resize(initial_size);
+	size_t capacity = GetMirrorSize(initial_size);
+	data_ = MapMirror(capacity);
+	if (data_ != nullptr) {
+		capacity_ = capacity;
+		mirrored_ = true;
+	}
+	else {
+		capacity_ = initial_size;
+		data_ = (char*)malloc(capacity_);
+	}
 }	
 
 BufferReader::~BufferReader()
 {
-	
+	if (mirrored_) {
+		UnmapMirror(data_, capacity_);
+	}
+	else {
+		free(data_);
+	}
 }
 
+bool BufferReader::Reserve(size_t size)
+{
+	if (WritableBytes() >= size) {
+		return true;
+	}
+
+	size_t readable = ReadableBytes();
+	if (!mirrored_ && capacity_ - readable >= size) {
+		// Իѿɶݰᵽͷ
+		memmove(data_, Peek(), readable);
+		reader_index_ = 0;
+		writer_index_ = readable;
+		return true;
+	}
+
+	if (capacity_ >= MAX_BUFFER_SIZE) {
+		return false;
+	}
+
+	size_t capacity = capacity_;
+	if (capacity == 0) {
+		capacity = 2048;
+	}
+	while (capacity - readable < size) {
+		capacity *= 2;
+	}
+
+	char* data = nullptr;
+	bool mirrored = false;
+	if (mirrored_) {
+		capacity = GetMirrorSize(capacity);
+		data = MapMirror(capacity);
+		mirrored = (data != nullptr);
+	}
+	if (data == nullptr) {
+		data = (char*)malloc(capacity);
+		if (data == nullptr) {
+			return false;
+		}
+	}
+
+	memcpy(data, Peek(), readable);
+	if (mirrored_) {
+		UnmapMirror(data_, capacity_);
+	}
+	else {
+		free(data_);
+	}
+
+	data_ = data;
+	capacity_ = capacity;
+	mirrored_ = mirrored;
+	reader_index_ = 0;
+	writer_index_ = readable;
+	return true;
+}
+
+/*
+ÿ read_size_ ֽڣ˵ںлиݣ´μӱ
+ kShrinkAfterReads ζķ֮һʱ룬ռô󻺳
+*/
 int BufferReader::Read(SOCKET sockfd)
 {	
+	if (!Reserve(read_size_) && WritableBytes() == 0) {
+		return 0;
+	}
+
 	uint32_t size = WritableBytes();
-	if(size < MAX_BYTES_PER_READ) {
-		uint32_t bufferReaderSize = (uint32_t)buffer_.size();
-		if(bufferReaderSize > MAX_BUFFER_SIZE) {
-			return 0; 
-		}
-        
-		buffer_.resize(bufferReaderSize + MAX_BYTES_PER_READ);
+	if (size > read_size_) {
+		size = read_size_;
 	}
 
-	int bytes_read = ::recv(sockfd, beginWrite(), MAX_BYTES_PER_READ, 0);
+	int bytes_read = ::recv(sockfd, beginWrite(), size, 0);
 	if(bytes_read > 0) {
 		writer_index_ += bytes_read;
+
+		if ((uint32_t)bytes_read == size && read_size_ < kMaxReadSize) {
+			read_size_ *= 2;
+			short_reads_ = 0;
+		}
+		else if ((uint32_t)bytes_read < read_size_ / 4 && read_size_ > kMinReadSize) {
+			if (++short_reads_ >= kShrinkAfterReads) {
+				read_size_ /= 2;
+				short_reads_ = 0;
+			}
+		}
+		else {
+			short_reads_ = 0;
+		}
+
+		// RtspResponse::ParseResponse Ȱ C ַңɶݺ油һ '\0'
+		if (WritableBytes() > 0) {
+			*beginWrite() = '\0';
+		}
 	}
 
 	return bytes_read;
@@ -21,17 +21,26 @@ uint32_t ReadUint24LE(char* data);
 uint16_t ReadUint16BE(char* data);
 uint16_t ReadUint16LE(char* data);
     
+/*
+ջ
+Linux ǻλͬһڴ棨memfdӳΣλƻؿͷʱַȻ
+Peek() ǷĿɶݣҪݣƽ̨ӳʧʱ˻ΪԻдʱƵͷ
+ÿ recv ĴСӦʱӱ kMaxReadSizeζʱ루С kMinReadSize
+*/
 class BufferReader
 {
 public:	
 	BufferReader(uint32_t initial_size = 2048);
 	virtual ~BufferReader();
 
+	BufferReader(const BufferReader&) = delete;
+	BufferReader& operator=(const BufferReader&) = delete;
+
 	uint32_t ReadableBytes() const
 	{ return (uint32_t)(writer_index_ - reader_index_); }
 
 	uint32_t WritableBytes() const
-	{  return (uint32_t)(buffer_.size() - writer_index_); }
+	{ return (uint32_t)(mirrored_ ? capacity_ - ReadableBytes() : capacity_ - writer_index_); }
 
 	char* Peek() 
 	{ return Begin() + reader_index_; }
@@ -67,6 +76,11 @@ public:
 				reader_index_ = 0;
 				writer_index_ = 0;
 			}
+			else if (mirrored_ && reader_index_ >= capacity_) {
+				// λýڶӳ䣬ƻصһݣͬһڴ棩
+				reader_index_ -= capacity_;
+				writer_index_ -= capacity_;
+			}
 		}
 		else {
 			RetrieveAll();
@@ -81,14 +95,14 @@ public:
 	uint32_t ReadUntilCrlf(std::string& data);
 
 	uint32_t Size() const 
-	{ return (uint32_t)buffer_.size(); }
+	{ return (uint32_t)capacity_; }
 
 private:
 	char* Begin()
-	{ return &*buffer_.begin(); }
+	{ return data_; }
 
 	const char* Begin() const
-	{ return &*buffer_.begin(); }
+	{ return data_; }
 
 	char* beginWrite()
 	{ return Begin() + writer_index_; }
@@ -96,12 +110,20 @@ private:
 	const char* BeginWrite() const
 	{ return Begin() + writer_index_; }
 
-	std::vector<char> buffer_;
+	bool Reserve(size_t size);	// ֤ size ֽڿд MAX_BUFFER_SIZE ʱ false
+
+	char* data_ = nullptr;
+	size_t capacity_ = 0;		// СӳʱΪһӳĴС
+	bool mirrored_ = false;
 	size_t reader_index_ = 0;
 	size_t writer_index_ = 0;
+	uint32_t read_size_;		// һ recv ĴС
+	uint32_t short_reads_ = 0;	//  read_size_ / 4 Ĵ
 
 	static const char kCRLF[];
-	static const uint32_t MAX_BYTES_PER_READ = 4096;
+	static const uint32_t kMinReadSize = 4096;
+	static const uint32_t kMaxReadSize = 256 * 1024;
+	static const uint32_t kShrinkAfterReads = 8;
 	static const uint32_t MAX_BUFFER_SIZE = 1024 * 100000;
 };
 
@@ -4,6 +4,15 @@
 #include "BufferWriter.h"
 #include "Socket.h"
 #include "SocketUtil.h"
+#if defined(__linux) || defined(__linux__)
+#include <linux/errqueue.h>
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#endif
 
 using namespace xop;
 
@@ -66,29 +75,70 @@ bool BufferWriter::Append(std::shared_ptr<char> data, uint32_t size, uint32_t in
 	}
      
 	Packet pkt = { data, size, index };
-	buffer_.emplace(std::move(pkt));
+	buffer_.emplace_back(std::move(pkt));
+	pending_bytes_ += size - index;
 	return true;
 }
 
+/*
+Сݿ chunk_ڶβƬ֮ʱֱչƬΣһ chunk_ ƬΡ
+ݵ䡣
+*/
 bool BufferWriter::Append(const char* data, uint32_t size, uint32_t index)
 {
 	if (size <= index) {
 		return false;
 	}
-     
-	if ((int)buffer_.size() >= max_queue_length_) {
-		return false;
+
+	data += index;
+	size -= index;
+
+	if (size > kMaxChunkCopy) {
+		if ((int)buffer_.size() >= max_queue_length_) {
+			return false;
+		}
+
+		Packet pkt;
+		pkt.data = AllocShared(size);
+		memcpy(pkt.data.get(), data, size);
+		pkt.size = size;
+		pkt.writeIndex = 0;
+		buffer_.emplace_back(std::move(pkt));
+		pending_bytes_ += size;
+		return true;
 	}
-     
-	Packet pkt;
-	pkt.data.reset(new char[size+512], std::default_delete<char[]>());
-	memcpy(pkt.data.get(), data, size);
-	pkt.size = size;
-	pkt.writeIndex = index;
-	buffer_.emplace(std::move(pkt));
+
+	if (chunk_ && buffer_.empty() && chunk_.use_count() == 1) {
+		chunk_used_ = 0;	// ڴƬãͷ
+	}
+
+	bool contiguous = chunk_ && kChunkSize - chunk_used_ >= size && !buffer_.empty()
+		&& buffer_.back().data == chunk_ && buffer_.back().size == chunk_used_;
+
+	if (!contiguous) {
+		if ((int)buffer_.size() >= max_queue_length_) {
+			return false;
+		}
+
+		if (!chunk_ || kChunkSize - chunk_used_ < size) {
+			chunk_ = AllocShared(kChunkSize);
+			chunk_used_ = 0;
+		}
+
+		Packet pkt = { chunk_, chunk_used_, chunk_used_ };
+		buffer_.emplace_back(std::move(pkt));
+	}
+
+	memcpy(chunk_.get() + chunk_used_, data, size);
+	chunk_used_ += size;
+	buffer_.back().size = chunk_used_;
+	pending_bytes_ += size;
 	return true;
 }
 
+/*
+Ѷ׵Ƭ֯ iovec һηֱͣȫꡢsocket ͻַͻ EAGAIN
+*/
 int BufferWriter::Send(SOCKET sockfd, int timeout)
 {		
 	if (timeout > 0) {
@@ -96,25 +146,54 @@ int BufferWriter::Send(SOCKET sockfd, int timeout)
 	}
       
 	int ret = 0;
-	int count = 1;
+	int total = 0;
 
-	do
-	{
-		if (buffer_.empty()) {
-			return 0;
+	while (!buffer_.empty()) {
+		uint32_t bytes = 0;
+		int count = 0;
+		bool zerocopy = false;
+#if defined(__linux) || defined(__linux__)
+		struct iovec iov[kMaxIovecs];
+		for (auto iter = buffer_.begin(); iter != buffer_.end() && count < kMaxIovecs; ++iter, ++count) {
+			iov[count].iov_base = iter->data.get() + iter->writeIndex;
+			iov[count].iov_len = iter->size - iter->writeIndex;
+			bytes += iter->size - iter->writeIndex;
+			if (zerocopy_threshold_ > 0 && iter->size - iter->writeIndex >= zerocopy_threshold_) {
+				zerocopy = true;
+			}
 		}
-		
-		count -= 1;
-		Packet &pkt = buffer_.front();
-		ret = ::send(sockfd, pkt.data.get() + pkt.writeIndex, pkt.size - pkt.writeIndex, 0);
+
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		ret = (int)::sendmsg(sockfd, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+		if (ret < 0 && zerocopy && errno == ENOBUFS) {
+			//  optmem ƣδɵ㿽ࣩһΰͨʽ
+			zerocopy = false;
+			ret = (int)::sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+		}
+#elif defined(WIN32) || defined(_WIN32)
+		WSABUF bufs[kMaxIovecs];
+		for (auto iter = buffer_.begin(); iter != buffer_.end() && count < kMaxIovecs; ++iter, ++count) {
+			bufs[count].buf = iter->data.get() + iter->writeIndex;
+			bufs[count].len = iter->size - iter->writeIndex;
+			bytes += iter->size - iter->writeIndex;
+		}
+
+		DWORD sent = 0;
+		ret = (WSASend(sockfd, bufs, count, &sent, 0, NULL, NULL) == 0) ? (int)sent : -1;
+#endif
 		if (ret > 0) {
-			pkt.writeIndex += ret;
-			if (pkt.size == pkt.writeIndex) {
-				count += 1;
-				buffer_.pop();
+			total += ret;
+			this->Retrieve((uint32_t)ret, zerocopy);
+			if ((uint32_t)ret < bytes) {
+				break;	// ͻ
 			}
+			continue;
 		}
-		else if (ret < 0) {
+
+		if (ret < 0) {
 #if defined(__linux) || defined(__linux__)
 		if (errno == EINTR || errno == EAGAIN) 
 #elif defined(WIN32) || defined(_WIN32)
@@ -125,13 +204,106 @@ int BufferWriter::Send(SOCKET sockfd, int timeout)
 				ret = 0;
 			}
 		}
-	} while (count > 0);
+		break;
+	}
 
 	if (timeout > 0) {
 		SocketUtil::SetNonBlock(sockfd);
 	}
     
-	return ret;
+	return ret < 0 ? ret : total;
 }
 
+/*
+ѷ͵ bytes ֽڣƬγӣһƬμ¼ַ͵λá
+㿽ʱ漰Ļε֪ͨűãͬһڴƬֻһΣ
+*/
+void BufferWriter::Retrieve(uint32_t bytes, bool zerocopy)
+{
+	if (zerocopy) {
+		uint32_t left = bytes;
+		for (auto iter = buffer_.begin(); iter != buffer_.end() && left > 0; ++iter) {
+			if (zerocopy_pending_.empty() || zerocopy_pending_.back().first != zerocopy_id_
+				|| zerocopy_pending_.back().second != iter->data) {
+				zerocopy_pending_.emplace_back(zerocopy_id_, iter->data);
+			}
+			uint32_t remaining = iter->size - iter->writeIndex;
+			left -= (left < remaining ? left : remaining);
+		}
+
+		zerocopy_id_ += 1;
+		zerocopy_stats_.sends += 1;
+		zerocopy_stats_.bytes += bytes;
+	}
+
+	pending_bytes_ -= (bytes < pending_bytes_ ? bytes : pending_bytes_);
+	while (bytes > 0 && !buffer_.empty()) {
+		Packet& pkt = buffer_.front();
+		uint32_t remaining = pkt.size - pkt.writeIndex;
+		if (bytes < remaining) {
+			pkt.writeIndex += bytes;
+			return;
+		}
+
+		bytes -= remaining;
+		buffer_.pop_front();
+	}
+}
+
+/*
+ÿ֪ͨһı [ee_info, ee_data]ͷűеĻá
+*/
+int BufferWriter::ReadZeroCopyCompletions(SOCKET sockfd)
+{
+	int notifications = 0;
+#if defined(__linux) || defined(__linux__)
+	while (true) {
+		char control[128];
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (::recvmsg(sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			break;	// EAGAINѿ
+		}
+
+		for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+				|| (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+				continue;
+			}
+
+			struct sock_extended_err* serr = (struct sock_extended_err*)CMSG_DATA(cmsg);
+			if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0) {
+				return -1;
+			}
+
+			uint32_t lo = serr->ee_info;
+			uint32_t hi = serr->ee_data;
+			zerocopy_stats_.completions += hi - lo + 1;
+			if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+				zerocopy_stats_.copied += hi - lo + 1;
+			}
 
+			for (auto iter = zerocopy_pending_.begin(); iter != zerocopy_pending_.end(); ) {
+				if (iter->first - lo <= hi - lo) {
+					iter = zerocopy_pending_.erase(iter);
+				}
+				else {
+					++iter;
+				}
+			}
+			notifications += 1;
+		}
+	}
+#endif
+	return notifications;
+}
+
+ZeroCopyStats BufferWriter::GetZeroCopyStats() const
+{
+	ZeroCopyStats stats = zerocopy_stats_;
+	stats.pending = zerocopy_pending_.size();
+	return stats;
+}
@@ -6,9 +6,10 @@
 
 #include <cstdint>
 #include <memory>
-#include <queue>
+#include <deque>
 #include <string>
 #include "Socket.h"
+#include "MemoryManager.h"
 
 namespace xop
 {
@@ -20,6 +21,25 @@ void WriteUint24LE(char* p, uint32_t value);
 void WriteUint16BE(char* p, uint16_t value);
 void WriteUint16LE(char* p, uint16_t value);
 	
+/*
+ͻscatter-gather
+Append(std::shared_ptr<char>) ֻüƬ [index, size)
+Append(const char*) ݿڴУСݺϲΪͬһƬΡ
+Send() һ sendmsg/WSASend  kMaxIovecs ƬΣַʱ¼Ƭε writeIndex ϡ
+㿽Linux MSG_ZEROCOPY socket  SO_ZEROCOPYСֵƬʱ MSG_ZEROCOPY ͣ
+ѷƬεñں˴Ӵ֪ͨɣReadZeroCopyCompletionsΪֹ
+*/
+
+// 㿽ͳ
+struct ZeroCopyStats
+{
+	uint64_t sends = 0;			//  MSG_ZEROCOPY  sendmsg 
+	uint64_t bytes = 0;			// ䷢͵ֽ
+	uint64_t completions = 0;	// յ֪ͨķʹ
+	uint64_t copied = 0;		// ں˻ΪĴ˵ֵ̫ͻ֧֣
+	uint64_t pending = 0;		// ȴ֪ͨĻ
+};
+
 class BufferWriter
 {
 public:
@@ -28,6 +48,7 @@ public:
 
 	bool Append(std::shared_ptr<char> data, uint32_t size, uint32_t index=0);
 	bool Append(const char* data, uint32_t size, uint32_t index=0);
+	// رη͵ֽ0 ʾΪջ socket ݲдС 0 ʾ
 	int Send(SOCKET sockfd, int timeout=0);
 
 	bool IsEmpty() const 
@@ -36,21 +57,57 @@ public:
 	bool IsFull() const 
 	{ return ((int)buffer_.size() >= max_queue_length_ ? true : false); }
 
+	// ܷ׷ count ƬΡһֶ Append ʱֻ׷ӽһ֡
+	bool HasRoom(uint32_t count) const
+	{ return (int)buffer_.size() + (int)count <= max_queue_length_; }
+
+	// Ƭ
 	uint32_t Size() const 
 	{ return (uint32_t)buffer_.size(); }
+
+	// ͵ֽ׷ʱۼӣʱ۳
+	uint64_t PendingBytes() const
+	{ return pending_bytes_; }
+
+	// threshold Ϊ 0 ʱر㿽
+	void SetZeroCopyThreshold(uint32_t threshold)
+	{ zerocopy_threshold_ = threshold; }
+
+	bool IsZeroCopy() const
+	{ return zerocopy_threshold_ > 0; }
+
+	// ȡе㿽֪ͨͷŶӦĻ EAGAIN Ϊֹ
+	// ش֪ͨ socket ʱ -1
+	int ReadZeroCopyCompletions(SOCKET sockfd);
+
+	ZeroCopyStats GetZeroCopyStats() const;
 	
 private:
 	typedef struct 
 	{
 		std::shared_ptr<char> data;
-		uint32_t size;
-		uint32_t writeIndex;
+		uint32_t size;			// Ƭνλ
+		uint32_t writeIndex;	// Ƭһֽڵλ
 	} Packet;
 
-	std::queue<Packet> buffer_;  		
+	void Retrieve(uint32_t bytes, bool zerocopy = false);
+
+	std::deque<Packet> buffer_;  		
 	int max_queue_length_ = 0;
+	uint64_t pending_bytes_ = 0;
+
+	std::shared_ptr<char> chunk_;	// Append(const char*) ǰʹõĿڴ飬Ƭιͬ
+	uint32_t chunk_used_ = 0;
+
+	uint32_t zerocopy_threshold_ = 0;	// ƬβСڴ˴Сʱʹ MSG_ZEROCOPY0 ʾر
+	uint32_t zerocopy_id_ = 0;			// һ㿽͵֪ͨţں˵ļһ£ 0 ʼ
+	std::deque<std::pair<uint32_t, std::shared_ptr<char>>> zerocopy_pending_;	// ֪ͨź͵ȴɵĻ
+	ZeroCopyStats zerocopy_stats_;
 	 
 	static const int kMaxQueueLength = 10000;
+	static const int kMaxIovecs = 1024;				// һ sendmsg ƬޣLinux IOV_MAX
+	static const uint32_t kChunkSize = 4096 - MemoryManager::kHeaderSize;	// ڴСϿͷ MemoryManager  4KB ּ
+	static const uint32_t kMaxChunkCopy = 1024;		// ˴Сݵ䣬ڴ
 };
 
 }
@@ -6,94 +6,186 @@
 #if defined(__linux) || defined(__linux__) 
 #include <sys/epoll.h>
 #include <errno.h>
+#include <unistd.h>
 #endif
 
 using namespace xop;
 
 /*
 epollʵʼС1024
-עwakeup_channel_Աڿ̻߳¼ѭ
+עwakeup_channel_Աڿ̻߳¼ѭʱ¼ѭ̻߳ûֱд Channel 
+edge_triggered Ϊ true ʱԱشʽעᣨeventfd  Wake() һζȡռҪ󣩡
 */
-EpollTaskScheduler::EpollTaskScheduler(int id)
-	: TaskScheduler(id)
+EpollTaskScheduler::EpollTaskScheduler(int id, TimerQueueType timer_queue_type, uint32_t timer_tick_us, bool edge_triggered)
+	: TaskScheduler(id, timer_queue_type, timer_tick_us)
+	, has_pending_updates_(false)
 {
+	edge_triggered_ = edge_triggered;
 #if defined(__linux) || defined(__linux__) 
     epollfd_ = epoll_create(1024);
  #endif
-    this->UpdateChannel(wakeup_channel_);
+	channels_.resize(1024);
+	this->ApplyUpdate(wakeup_channel_);
 }
 
 EpollTaskScheduler::~EpollTaskScheduler()
 {
-	
+#if defined(__linux) || defined(__linux__) 
+	if (epollfd_ >= 0) {
+		::close(epollfd_);
+	}
+#endif
 }
 
 /*
 ܣӻChannel¼
-߼
-ChannelѴڣ
-¼ΪEVENT_NONEepollchannels_ɾ
-򣬸epoll¼
-Channelйע¼ӵepollchannels_
+¼ѭֱ߳޸ģ̵߳޸İ˳б¼ѭִС
 */
 void EpollTaskScheduler::UpdateChannel(ChannelPtr channel)
 {
-	std::lock_guard<std::mutex> lock(mutex_);
+	if (IsInLoopThread()) {
+		this->ApplyUpdate(channel);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		PendingUpdate update;
+		update.channel = std::move(channel);
+		pending_updates_.push_back(std::move(update));
+		has_pending_updates_.store(true, std::memory_order_release);
+	}
+	this->WakeLoop();
+}
+
+/*
+ܣepollChannelƳָChannel
+;ӹرջҪ¼ʱá
+̵߳ʱֱӴ epoll ɾepoll_ctl ̰߳ȫģ÷ʱûйر fd
+ٲµ¼Channel еļ¼¼ѭ߳Ժ
+*/
+void EpollTaskScheduler::RemoveChannel(ChannelPtr& channel)
+{
+	if (IsInLoopThread()) {
+		this->ApplyRemove(channel);
+		return;
+	}
+
+#if defined(__linux) || defined(__linux__) 
+	struct epoll_event event = { 0 };
+	::epoll_ctl(epollfd_, EPOLL_CTL_DEL, channel->GetSocket(), &event);
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		PendingUpdate update;
+		update.channel = channel;
+		update.remove = true;
+		pending_updates_.push_back(std::move(update));
+		has_pending_updates_.store(true, std::memory_order_release);
+	}
+	this->WakeLoop();
+}
+
+/*
+߼
+fd ͬһ Channel¼Ϊ EVENT_NONE ʱ epoll ͱɾ޸ļ¼
+fd һ Channelԭ fd ѹرաűãɵɾڴбУΪգ
+йע¼ʱµĴעᡣ
+*/
+void EpollTaskScheduler::ApplyUpdate(const ChannelPtr& channel)
+{
 #if defined(__linux) || defined(__linux__) 
 	int fd = channel->GetSocket();
-	if(channels_.find(fd) != channels_.end()) {
-		if(channel->IsNoneEvent()) {
-			Update(EPOLL_CTL_DEL, channel);
-			channels_.erase(fd);
+	if (fd < 0) {
+		return;
+	}
+
+	if ((size_t)fd >= channels_.size()) {
+		if (channel->IsNoneEvent()) {
+			return;
+		}
+		channels_.resize(((size_t)fd + 1) * 2);
+	}
+
+	ChannelEntry& entry = channels_[fd];
+	if (entry.channel == channel) {
+		if (channel->IsNoneEvent()) {
+			Update(EPOLL_CTL_DEL, fd, entry);
+			entry.channel.reset();
 		}
 		else {
-			Update(EPOLL_CTL_MOD, channel);
+			Update(EPOLL_CTL_MOD, fd, entry);
 		}
 	}
-	else {
-		if(!channel->IsNoneEvent()) {
-			channels_.emplace(fd, channel);
-			Update(EPOLL_CTL_ADD, channel);
-		}	
-	}	
+	else if (!channel->IsNoneEvent()) {
+		entry.channel = channel;
+		entry.generation += 1;
+		Update(EPOLL_CTL_ADD, fd, entry);
+	}
 #endif
 }
 
-/*
-ܣװepoll_ctlϵͳãepollʵע/޸/ɾ¼
-ؼ㣺
-event.data.ptr洢Channelԭʼָ룬¼ʱٶλ
-δepoll_ctlĴ־¼쳣׳
-*/
-void EpollTaskScheduler::Update(int operation, ChannelPtr& channel)
+void EpollTaskScheduler::ApplyRemove(const ChannelPtr& channel)
 {
 #if defined(__linux) || defined(__linux__) 
-	struct epoll_event event = {0};
+	int fd = channel->GetSocket();
+	if (fd >= 0 && (size_t)fd < channels_.size() && channels_[fd].channel == channel) {
+		Update(EPOLL_CTL_DEL, fd, channels_[fd]);
+		channels_[fd].channel.reset();
+	}
+#endif
+}
 
-	if(operation != EPOLL_CTL_DEL) {
-		event.data.ptr = channel.get();
-		event.events = channel->GetEvents();
+/*
+¼ѭ߳ڰύ˳̵ִ߳޸ģûд޸ʱֻһԭӶ
+*/
+void EpollTaskScheduler::ApplyPendingUpdates()
+{
+	if (!has_pending_updates_.load(std::memory_order_acquire)) {
+		return;
 	}
 
-	if(::epoll_ctl(epollfd_, operation, channel->GetSocket(), &event) < 0) {
+	std::vector<PendingUpdate> updates;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		updates.swap(pending_updates_);
+		has_pending_updates_.store(false, std::memory_order_relaxed);
+	}
 
+	for (auto& update : updates) {
+		if (update.remove) {
+			this->ApplyRemove(update.channel);
+		}
+		else {
+			this->ApplyUpdate(update.channel);
+		}
 	}
-#endif
 }
 
 /*
-ܣepollchannels_ƳָChannel
-;ӹرջҪ¼ʱá
+ܣװepoll_ctlϵͳãepollʵע/޸/ɾ¼
+ؼ㣺
+event.data.u64  fd ʹ¼ʱݴ Channel жλУ顣
+fd ľע epoll Уñŵľ fd  dup ʱ ADD  EEXISTΪ MOD
 */
-void EpollTaskScheduler::RemoveChannel(ChannelPtr& channel)
+void EpollTaskScheduler::Update(int operation, int fd, ChannelEntry& entry)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
 #if defined(__linux) || defined(__linux__) 
-	int fd = channel->GetSocket();
+	struct epoll_event event = {0};
+
+	if(operation != EPOLL_CTL_DEL) {
+		event.data.u64 = MakeEventData(fd, entry.generation);
+		event.events = entry.channel->GetEvents();
+		if (edge_triggered_) {
+			event.events |= EPOLLET;
+		}
+	}
 
-	if(channels_.find(fd) != channels_.end()) {
-		Update(EPOLL_CTL_DEL, channel);
-		channels_.erase(fd);
+	if(::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
+		if (operation == EPOLL_CTL_ADD && errno == EEXIST) {
+			::epoll_ctl(epollfd_, EPOLL_CTL_MOD, fd, &event);
+		}
 	}
 #endif
 }
@@ -102,7 +194,7 @@ void EpollTaskScheduler::RemoveChannel(ChannelPtr& channel)
 ܣ¼ѭȴ¼
 ̣
 epoll_waitȴ¼ʱʱɲָ룩
-¼ͨevent.data.ptrȡChannel
+¼ͨevent.data.u64еfdʹChannelҵChannel
 Channel::HandleEvent()¼д󣩡
 ؼ㣺
 ÿദ512¼eventsС
@@ -111,6 +203,9 @@ void EpollTaskScheduler::RemoveChannel(ChannelPtr& channel)
 bool EpollTaskScheduler::HandleEvent(int timeout)
 {
 #if defined(__linux) || defined(__linux__) 
+	loop_thread_id_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	this->ApplyPendingUpdates();
+
 	struct epoll_event events[512] = {0};
 	int num_events = -1;
 
@@ -121,10 +216,22 @@ bool EpollTaskScheduler::HandleEvent(int timeout)
 		}								
 	}
 
+	this->RecordWakeup(num_events > 0 ? (uint32_t)num_events : 0);
+
 	for(int n=0; n<num_events; n++) {
-		if(events[n].data.ptr) {        
-			((Channel *)events[n].data.ptr)->HandleEvent(events[n].events);
+		int fd = (int)(uint32_t)events[n].data.u64;
+		uint32_t generation = (uint32_t)(events[n].data.u64 >> 32);
+		if (fd < 0 || (size_t)fd >= channels_.size()) {
+			continue;
+		}
+
+		ChannelEntry& entry = channels_[fd];
+		if (!entry.channel || entry.generation != generation) {
+			continue;	// ͬһ¼ѱɾ fd ѱ
 		}
+
+		ChannelPtr channel = entry.channel;	// صпɾԼ
+		channel->HandleEvent(events[n].events);
 	}		
 	return true;
 #else
@@ -15,18 +15,27 @@ EpollTaskScheduler
 
 #include "TaskScheduler.h"
 #include <mutex>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 namespace xop
 {
 /*
 ְ𣺻LinuxepollʵֵĸЧI/O¼̳TaskSchedulerChannel¼ַ
 ģʽReactorģʽͨepollʵֶ·ãSocket¼ӦChannelص
+
+Channel  fd ±ţֻ¼ѭ̶߳д
+¼ѭ߳ڵ UpdateChannel/RemoveChannel ֱӵ epoll_ctl̵߳޸ķб¼ѭ
+¼ѭ߳һ epoll_wait ֮ǰύ˳ִС
+epoll_event.data.u64  fd ʹɣfd ÿעһµ Channel һ
+ַʱͬһ¼ѱɾ fd ѱã¼ֱӶصڼ ChannelPtrصɾԼҲǰȫġ
 */
 class EpollTaskScheduler : public TaskScheduler
 {
 public:
-	EpollTaskScheduler(int id = 0);
+	// edge_triggered:  EPOLLET ע ChannelصҪ/д/accept  EAGAIN Ϊֹ
+	EpollTaskScheduler(int id = 0, TimerQueueType timer_queue_type = TIMER_QUEUE_MAP, uint32_t timer_tick_us = 1000,
+	                   bool edge_triggered = false);
 	virtual ~EpollTaskScheduler();
 
 	void UpdateChannel(ChannelPtr channel);
@@ -36,11 +45,31 @@ public:
 	bool HandleEvent(int timeout);
 
 private:
-	void Update(int operation, ChannelPtr& channel);
+	struct ChannelEntry
+	{
+		ChannelPtr channel;
+		uint32_t generation = 0;
+	};
+
+	struct PendingUpdate
+	{
+		ChannelPtr channel;
+		bool remove = false;
+	};
+
+	void ApplyUpdate(const ChannelPtr& channel);
+	void ApplyRemove(const ChannelPtr& channel);
+	void ApplyPendingUpdates();
+	void Update(int operation, int fd, ChannelEntry& entry);
+
+	static uint64_t MakeEventData(int fd, uint32_t generation)
+	{ return ((uint64_t)generation << 32) | (uint32_t)fd; }
 
 	int epollfd_ = -1;
-	std::mutex mutex_;
-	std::unordered_map<int, ChannelPtr> channels_;	// άSocketļintChannelӳ䣬ڿٲҺ͹עChannel
+	std::vector<ChannelEntry> channels_;		//  fd ±ŵ Channel ֻ¼ѭ߳ڷʡ
+	std::mutex mutex_;							//  pending_updates_
+	std::vector<PendingUpdate> pending_updates_;	// ߳ύ޸
+	std::atomic<bool> has_pending_updates_;
 };
 
 }
@@ -2,6 +2,7 @@
 // 2019-10-18
 
 #include "EventLoop.h"
+#include "Logger.h"
 
 #if defined(WIN32) || defined(_WIN32) 
 #include<windows.h>
@@ -19,7 +20,14 @@ using namespace xop;
 ؼ Loop() ¼ѭ̡߳
 */
 EventLoop::EventLoop(uint32_t num_threads)
-	: index_(1)
+	: EventLoop(num_threads, EventLoopOptions())
+{
+
+}
+
+EventLoop::EventLoop(uint32_t num_threads, const EventLoopOptions& options)
+	: options_(options)
+	, placement_policy_(PlacementPolicy::Create(options.connection_placement))
 {
 	num_threads_ = 1;
 	if (num_threads > 0) {
@@ -42,31 +50,84 @@ EventLoop::~EventLoop()
 ܣȡһ
 ԣ
 ֱ̣߳ӷΨһĵ
-̣߳ѯزͬʵָؾ⡣
+̣߳һ accept ȫֶʱɷòĸؿѡһ
 ;ûͨ˽ӿڽ䵽̡ͬ߳
 */
 std::shared_ptr<TaskScheduler> EventLoop::GetTaskScheduler()
 {
 	std::lock_guard<std::mutex> locker(mutex_);
+	if (task_schedulers_.empty()) {
+		return nullptr;
+	}
+
 	if (task_schedulers_.size() == 1) {
 		return task_schedulers_.at(0);
 	}
-	else {
-		auto task_scheduler = task_schedulers_.at(index_);
-		index_++;
-		if (index_ >= task_schedulers_.size()) {
-			index_ = 1;
-		}		
-		return task_scheduler;
+
+	std::vector<LoadStats> loads;
+	loads.reserve(task_schedulers_.size() - 1);
+	for (size_t n = 1; n < task_schedulers_.size(); n++) {
+		loads.push_back(task_schedulers_[n]->GetLoadStats());
+	}
+
+	size_t index = placement_policy_->Select(loads);
+	if (index >= loads.size()) {
+		index = 0;
+	}
+	return task_schedulers_.at(index + 1);
+}
+
+void EventLoop::SetPlacementPolicy(std::shared_ptr<PlacementPolicy> policy)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	if (policy) {
+		placement_policy_ = policy;
 	}
+}
 
+/*
+ܣŻȡҪȫĳƬ
+*/
+std::shared_ptr<TaskScheduler> EventLoop::GetTaskScheduler(uint32_t id)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	if (id < task_schedulers_.size()) {
+		return task_schedulers_.at(id);
+	}
 	return nullptr;
 }
 
+IoStats EventLoop::GetIoStats()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	IoStats total;
+	for (auto& task_scheduler : task_schedulers_) {
+		IoStats stats = task_scheduler->GetIoStats();
+		total.wakeups += stats.wakeups;
+		total.events += stats.events;
+		total.read_events += stats.read_events;
+		total.extra_reads += stats.extra_reads;
+		total.accept_events += stats.accept_events;
+		total.extra_accepts += stats.extra_accepts;
+		total.tasks += stats.tasks;
+	}
+	return total;
+}
+
+std::vector<LoadStats> EventLoop::GetLoadStats()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	std::vector<LoadStats> loads;
+	for (auto& task_scheduler : task_schedulers_) {
+		loads.push_back(task_scheduler->GetLoadStats());
+	}
+	return loads;
+}
+
 /*
 Ĺܣʼ߳¼ѭTaskSchedulerÿڶ߳УI/O¼ʱʹ
 ƽ̨䣺ݲϵͳѡЧĶ·ûƣLinuxepollWindowsselect
-߳ȼ߳ȼWindowsʵ֣
+߳ȼڵ߳ȼCPU󶨣ThreadPlacement¼ʵʷ
 */
 /*
 EventLoop::Loop()
@@ -77,7 +138,7 @@ EventLoop::Loop()
      TaskScheduler 
     ִ߳ TaskScheduler::Start()
     洢߳
- ߳ȼWindows
+ ߳ȼCPU󶨲¼־
   (mutex_)
 */
 void EventLoop::Loop()
@@ -94,57 +155,79 @@ void EventLoop::Loop()
 	Linuxʹ EpollTaskScheduler epoll ĸI/O·ã
 	Windowsʹ SelectTaskScheduler selectݵЧʽϵͣ
 	洢ָ task_schedulers_ 
-	߳Ϊỵִ̈߳ TaskScheduler::Start() ¼ѭ
-	룺thread->native_handle() ȡδʹãɾ
+	߳Ϊỵ̈߳ȼCPU󶨣ThreadPlacementִ TaskScheduler::Start() ¼ѭ
 	*/
+	// Ҫʱ n ߳ʹ layout[n % layout.size()]
+	std::vector<int> layout;
+	if (options_.placement.pin_cpu) {
+		layout = options_.placement.cpus.empty() ? ThreadPlacement::GetDefaultLayout() : options_.placement.cpus;
+	}
+
 	for (uint32_t n = 0; n < num_threads_; n++) 
 	{
-#if defined(__linux) || defined(__linux__) 
-		std::shared_ptr<TaskScheduler> task_scheduler_ptr(new EpollTaskScheduler(n));
-#elif defined(WIN32) || defined(_WIN32) 
-		std::shared_ptr<TaskScheduler> task_scheduler_ptr(new SelectTaskScheduler(n));
-#endif
+		std::shared_ptr<TaskScheduler> task_scheduler_ptr(this->CreateTaskScheduler(n));
 		task_schedulers_.push_back(task_scheduler_ptr);
-		std::shared_ptr<std::thread> thread(new std::thread(&TaskScheduler::Start, task_scheduler_ptr.get()));
-		thread->native_handle();
-		threads_.push_back(thread);
 
-		// EventLoop棬һ߳ȥһ
+		// EventLoop棬һ߳ȥһ߳ȼCPU󶨣ٽ¼ѭ
+		int cpu = layout.empty() ? -1 : layout[n % layout.size()];
+		std::shared_ptr<std::thread> thread(new std::thread([this, task_scheduler_ptr, n, cpu]() {
+			this->ApplyPlacement(n, cpu);
+			task_scheduler_ptr->Start();
+		}));
+		threads_.push_back(thread);
 	}
+}
 
-	const int priority = TASK_SCHEDULER_PRIORITY_REALTIME;
+/*
+ܣ options_.scheduler_type 
+io_uring ãں˰汾͡ seccomp  sysctl ã򴴽ʧʱ˵ epollWindows ֻ select
+edge_triggered ֻ epoll Чio_uring  select Ϊˮƽ
+*/
+TaskScheduler* EventLoop::CreateTaskScheduler(uint32_t id)
+{
+	TimerQueueType timer_queue_type = options_.timer_queue_type;
+	uint32_t timer_tick_us = options_.timer_tick_us;
 
-	// ߳ȼWindows
-	/*
-	ȼTASK_SCHEDULER_PRIORITY_REALTIME Ӧʵʱȼ
-	Windowsʵ֣ͨ SetThreadPriority ߳ȼؼӦٶȡ
-	Linuxȱʧδʵȼã貹 pthread ش루 pthread_setschedparam
-	*/
-	for (auto iter : threads_) 
-	{
 #if defined(__linux) || defined(__linux__) 
-
-#elif defined(WIN32) || defined(_WIN32) 
-		switch (priority) 
-		{
-		case TASK_SCHEDULER_PRIORITY_LOW:
-			SetThreadPriority(iter->native_handle(), THREAD_PRIORITY_BELOW_NORMAL);
-			break;
-		case TASK_SCHEDULER_PRIORITY_NORMAL:
-			SetThreadPriority(iter->native_handle(), THREAD_PRIORITY_NORMAL);
-			break;
-		case TASK_SCHEDULER_PRIORITYO_HIGH:
-			SetThreadPriority(iter->native_handle(), THREAD_PRIORITY_ABOVE_NORMAL);
-			break;
-		case TASK_SCHEDULER_PRIORITY_HIGHEST:
-			SetThreadPriority(iter->native_handle(), THREAD_PRIORITY_HIGHEST);
-			break;
-		case TASK_SCHEDULER_PRIORITY_REALTIME:
-			SetThreadPriority(iter->native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+	switch (options_.scheduler_type)
+	{
+	case TASK_SCHEDULER_IO_URING:
+		if (IoUringTaskScheduler::IsSupported()) {
+			IoUringTaskScheduler* task_scheduler = new IoUringTaskScheduler(id, timer_queue_type, timer_tick_us);
+			if (task_scheduler->IsReady()) {
+				return task_scheduler;
+			}
+			delete task_scheduler;
+			LOG_INFO("[EventLoop] scheduler %u: io_uring setup failed, falling back to epoll.\n", id);
 			break;
 		}
-#endif
+		if (id == 0) {
+			LOG_INFO("[EventLoop] io_uring is not available, falling back to epoll.\n");
+		}
+		break;
+	case TASK_SCHEDULER_SELECT:
+		return new SelectTaskScheduler(id, timer_queue_type, timer_tick_us);
+	default:
+		break;
 	}
+	return new EpollTaskScheduler(id, timer_queue_type, timer_tick_us, options_.edge_triggered);
+#elif defined(WIN32) || defined(_WIN32) 
+	return new SelectTaskScheduler(id, timer_queue_type, timer_tick_us);
+#endif
+}
+
+/*
+ܣڵ߳ڲȼCPU׺ԣ¼ʵЧķ
+ʧܣû CAP_SYS_NICEֻ¼־߳ճС
+*/
+void EventLoop::ApplyPlacement(uint32_t n, int cpu)
+{
+	bool priority_ok = ThreadPlacement::SetPriority(options_.placement.priority, options_.placement.sched_fifo);
+	bool affinity_ok = cpu < 0 || ThreadPlacement::SetAffinity(cpu);
+
+	LOG_INFO("[EventLoop] scheduler %u: %s%s%s\n", n, ThreadPlacement::Describe().c_str(),
+		priority_ok ? "" : ", priority not applied",
+		affinity_ok ? "" : ", affinity not applied");
 }
 
 /*
@@ -192,7 +275,9 @@ void EventLoop::RemoveChannel(ChannelPtr& channel)
 }
 
 /*
-Ӷʱɵһ
+ȫֶʱɵһصڵһִ߳У
+ӡỰصĶʱӦʹ AddTimer()ⶼڵһ߳ϡ
+߳ʱ TaskScheduler::AddTimer() ỽѵһ¼ȴʱ䡣
 */
 TimerId EventLoop::AddTimer(TimerEvent timerEvent, uint32_t msec)
 {
@@ -215,13 +300,14 @@ void EventLoop::RemoveTimer(TimerId timerId)
 }
 
 /*
-Ļص¼֪߳ͨ
+ȫֻص¼ڵһִ߳У
+ĳӵĻصӦͶݵĵTaskScheduler::AddTriggerEvent()/RunInLoop()
 */
 bool EventLoop::AddTriggerEvent(TriggerEvent callback)
 {   
 	std::lock_guard<std::mutex> locker(mutex_);
 	if (task_schedulers_.size() > 0) {
-		return task_schedulers_[0]->AddTriggerEvent(callback);
+		return task_schedulers_[0]->AddTriggerEvent(std::move(callback));
 	}
 	return false;
 }
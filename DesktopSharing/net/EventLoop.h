@@ -22,27 +22,44 @@
 
 #include "SelectTaskScheduler.h"
 #include "EpollTaskScheduler.h"
+#include "IoUringTaskScheduler.h"
 #include "Pipe.h"
 #include "Timer.h"
 #include "RingBuffer.h"
-
-#define TASK_SCHEDULER_PRIORITY_LOW       0
-#define TASK_SCHEDULER_PRIORITY_NORMAL    1
-#define TASK_SCHEDULER_PRIORITYO_HIGH     2 
-#define TASK_SCHEDULER_PRIORITY_HIGHEST   3
-#define TASK_SCHEDULER_PRIORITY_REALTIME  4
+#include "ThreadPlacement.h"
+#include "PlacementPolicy.h"
 
 namespace xop
 {
 
+// I/O ·ú
+enum TaskSchedulerType
+{
+	TASK_SCHEDULER_DEFAULT  = 0,	// Linux ʹ epollWindows ʹ select
+	TASK_SCHEDULER_EPOLL    = 1,
+	TASK_SCHEDULER_SELECT   = 2,
+	TASK_SCHEDULER_IO_URING = 3,	// io_uring poll ˣLinux 5.11+ֻ֧򴴽ʧʱԶ˵ epoll
+};
+
+// EventLoop 
+struct EventLoopOptions
+{
+	TaskSchedulerType scheduler_type = TASK_SCHEDULER_DEFAULT;
+	TimerQueueType timer_queue_type = TIMER_QUEUE_MAP;	// TIMER_QUEUE_WHEEL Ϊֲʱ
+	uint32_t timer_tick_us = 1000;						// ʱ tick΢룩С 1000
+	ThreadPlacementOptions placement;					// ̵߳ȼCPU󶨣 ThreadPlacement.h
+	bool edge_triggered = false;						// epoll  EPOLLET עᣬд accept  EAGAIN Ϊֹ
+	PlacementPolicyType connection_placement = PLACEMENT_ROUND_ROBIN;	// GetTaskScheduler() ѡĲԣ PlacementPolicy.h
+};
+
 /*
-߳ȣֶ֧TaskSchedulerÿڶ߳УͨѯԷܡ
+߳ȣֶ֧TaskSchedulerÿڶ߳УòԣPlacementPolicyӣܡ
 
 ƽ̨֧֣
 LinuxʹEpollTaskSchedulerepollĸЧI/O·ã
 WindowsʹSelectTaskSchedulerselectԽϺõЧʽϵͣ
 
-ȼ߳ȼWindowsƽ̨֧ʵʱ
+ȼ߳ȼCPU󶨣Windows/Linux ThreadPlacement֧ʵʱ
 */
 class EventLoop 
 {
@@ -50,10 +67,26 @@ public:
 	EventLoop(const EventLoop&) = delete;
 	EventLoop &operator = (const EventLoop&) = delete; 
 	EventLoop(uint32_t num_threads =1);  //std::thread::hardware_concurrency()
+	EventLoop(uint32_t num_threads, const EventLoopOptions& options);
 	virtual ~EventLoop();
 
+	// ߳ʱòԴӵڶѡһ߳ʱΨһĵ
 	std::shared_ptr<TaskScheduler> GetTaskScheduler();
+	// Żȡ0 ~ GetThreadNum()-1Чʱ nullptr
+	std::shared_ptr<TaskScheduler> GetTaskScheduler(uint32_t id);
+
+	uint32_t GetThreadNum() const
+	{ return num_threads_; }
+
+	// е I/O ͳ֮ͣWakeupsSaved() Ϊ accept/read ʡµĻѴ
+	IoStats GetIoStats();
 
+	// 滻òԣĬ EventLoopOptions::connection_placement ɴԶʵ֡
+	void SetPlacementPolicy(std::shared_ptr<PlacementPolicy> policy);
+	// ÿĸأ±꼴š
+	std::vector<LoadStats> GetLoadStats();
+
+	// ȫ붨ʱڵһִУӵ붨ʱʹTcpConnection::GetTaskScheduler()
 	bool AddTriggerEvent(TriggerEvent callback);
 	TimerId AddTimer(TimerEvent timerEvent, uint32_t msec);
 	void RemoveTimer(TimerId timerId);	
@@ -64,9 +97,13 @@ public:
 	void Quit();
 
 private:
+	TaskScheduler* CreateTaskScheduler(uint32_t id);
+	void ApplyPlacement(uint32_t n, int cpu);
+
 	std::mutex mutex_;			// ԹԴб߳бĲʡ
 	uint32_t num_threads_ = 1;	// ¼ѭ߳Ĭ1ͨ캯ָ
-	uint32_t index_ = 1;		// ѯڶ̳߳¾
+	EventLoopOptions options_;	// ·úˡʱʵ̷֡߳õȹ
+	std::shared_ptr<PlacementPolicy> placement_policy_;	// ӵĵòԡ
 	std::vector<std::shared_ptr<TaskScheduler>> task_schedulers_;	// 洢ÿһ¼ѭ̡߳
 	std::vector<std::shared_ptr<std::thread>> threads_;				// 洢̶߳ÿ߳һ
 };
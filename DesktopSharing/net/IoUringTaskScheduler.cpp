@@ -0,0 +1,411 @@
+#include "IoUringTaskScheduler.h"
+
+#if defined(__linux) || defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#endif
+
+using namespace xop;
+
+#if defined(__linux) || defined(__linux__)
+
+static int IoUringSetup(unsigned entries, struct io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t size)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, size);
+}
+
+#endif
+
+IoUringTaskScheduler::IoUringTaskScheduler(int id, TimerQueueType timer_queue_type, uint32_t timer_tick_us)
+	: TaskScheduler(id, timer_queue_type, timer_tick_us)
+{
+	if (this->Setup()) {
+		this->UpdateChannel(wakeup_channel_);
+	}
+}
+
+IoUringTaskScheduler::~IoUringTaskScheduler()
+{
+	this->Teardown();
+}
+
+/*
+ͷӳĻر ring_fd_Setup() ʧ·á
+֮ ring_fd_ Ϊ -1UpdateChannel/HandleEvent ٷʻ
+*/
+void IoUringTaskScheduler::Teardown()
+{
+#if defined(__linux) || defined(__linux__)
+	if (sqes_) {
+		munmap(sqes_, sqes_size_);
+	}
+	if (cq_ring_ && cq_ring_ != sq_ring_) {
+		munmap(cq_ring_, cq_ring_size_);
+	}
+	if (sq_ring_) {
+		munmap(sq_ring_, sq_ring_size_);
+	}
+	if (ring_fd_ >= 0) {
+		::close(ring_fd_);
+	}
+#endif
+	ring_fd_ = -1;
+	sq_ring_ = cq_ring_ = sqes_ = nullptr;
+	sq_head_ = sq_tail_ = sq_mask_ = sq_entries_ = sq_array_ = nullptr;
+	cq_head_ = cq_tail_ = cq_mask_ = nullptr;
+	cqes_ = nullptr;
+}
+
+/*
+̽һΣܴ io_uring ֧ IORING_FEAT_EXT_ARG
+ seccomp  io_uringں˹ر io_uringkernel.io_uring_disabledʱ᷵ false
+*/
+bool IoUringTaskScheduler::IsSupported()
+{
+	static std::once_flag flag;
+	static bool supported = false;
+
+	std::call_once(flag, [] {
+#if defined(__linux) || defined(__linux__)
+		struct io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int fd = IoUringSetup(4, &params);
+		if (fd >= 0) {
+			supported = (params.features & IORING_FEAT_EXT_ARG) != 0;
+			::close(fd);
+		}
+#endif
+	});
+
+	return supported;
+}
+
+/*
+ io_uring ʵӳύСɶк SQE 顣
+ɶȡύеں֧ IORING_FEAT_NODROP ʱ¼Ҳᶪʧ
+IsSupported() ͨһɹ RLIMIT_MEMLOCK ʱ mmap ʧܣʧʱͷѷĲ֡
+*/
+bool IoUringTaskScheduler::Setup()
+{
+#if defined(__linux) || defined(__linux__)
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+	params.cq_entries = kRingEntries * 2;
+
+	ring_fd_ = IoUringSetup(kRingEntries, &params);
+	if (ring_fd_ < 0) {
+		return false;
+	}
+
+	sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_ring_size_ > sq_ring_size_) {
+			sq_ring_size_ = cq_ring_size_;
+		}
+		cq_ring_size_ = sq_ring_size_;
+	}
+
+	sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if (sq_ring_ == MAP_FAILED) {
+		sq_ring_ = nullptr;
+		this->Teardown();
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ring_ = sq_ring_;
+	}
+	else {
+		cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+		if (cq_ring_ == MAP_FAILED) {
+			cq_ring_ = nullptr;
+			this->Teardown();
+			return false;
+		}
+	}
+
+	sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+	sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if (sqes_ == MAP_FAILED) {
+		sqes_ = nullptr;
+		this->Teardown();
+		return false;
+	}
+
+	char* sq = (char*)sq_ring_;
+	sq_head_ = (unsigned*)(sq + params.sq_off.head);
+	sq_tail_ = (unsigned*)(sq + params.sq_off.tail);
+	sq_mask_ = (unsigned*)(sq + params.sq_off.ring_mask);
+	sq_entries_ = (unsigned*)(sq + params.sq_off.ring_entries);
+	sq_array_ = (unsigned*)(sq + params.sq_off.array);
+	sq_local_tail_ = *sq_tail_;
+
+	char* cq = (char*)cq_ring_;
+	cq_head_ = (unsigned*)(cq + params.cq_off.head);
+	cq_tail_ = (unsigned*)(cq + params.cq_off.tail);
+	cq_mask_ = (unsigned*)(cq + params.cq_off.ring_mask);
+	cqes_ = cq + params.cq_off.cqes;
+
+	events_.reserve(params.cq_entries);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ȡһе SQE÷ mutex_ύʱȰеύںˡ
+*/
+void* IoUringTaskScheduler::GetSqe()
+{
+#if defined(__linux) || defined(__linux__)
+	if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= *sq_entries_) {
+		this->Submit();
+		if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= *sq_entries_) {
+			return nullptr;
+		}
+	}
+
+	unsigned index = sq_local_tail_ & *sq_mask_;
+	struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ + index;
+	memset(sqe, 0, sizeof(*sqe));
+	sq_array_[index] = index;
+	sq_local_tail_ += 1;
+	return sqe;
+#else
+	return nullptr;
+#endif
+}
+
+void IoUringTaskScheduler::PollAdd(int fd, ChannelEntry& entry)
+{
+#if defined(__linux) || defined(__linux__)
+	struct io_uring_sqe* sqe = (struct io_uring_sqe*)this->GetSqe();
+	if (sqe == nullptr) {
+		return;
+	}
+
+	generation_ += 1;
+	if (generation_ == 0) {
+		generation_ = 1;
+	}
+	entry.generation = generation_;
+	entry.armed = true;
+
+	// Channel ¼ֵ poll ¼ֵͬEVENT_RDHUP == POLLRDHUP
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = (uint32_t)entry.channel->GetEvents();
+	sqe->user_data = MakeUserData(fd, entry.generation);
+#endif
+}
+
+void IoUringTaskScheduler::PollRemove(int fd, ChannelEntry& entry)
+{
+#if defined(__linux) || defined(__linux__)
+	if (!entry.armed) {
+		return;
+	}
+
+	struct io_uring_sqe* sqe = (struct io_uring_sqe*)this->GetSqe();
+	if (sqe == nullptr) {
+		return;
+	}
+
+	// ȡ POLL_ADD  -ECANCELED ɣѾʧЧHandleEvent ֱӶ
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = MakeUserData(fd, entry.generation);
+	sqe->user_data = 0;
+	entry.armed = false;
+#endif
+}
+
+/*
+βָ벢ύ÷ mutex_
+*/
+void IoUringTaskScheduler::Submit()
+{
+#if defined(__linux) || defined(__linux__)
+	__atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+	unsigned to_submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+	if (to_submit > 0) {
+		IoUringEnter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+	}
+#endif
+}
+
+/*
+ܣӻChannel¼
+¼仯ʱȡɵ POLL_ADD µĴύûйע¼ʱɾ
+¼ѭֻ߳дύУ߳ύ
+*/
+void IoUringTaskScheduler::UpdateChannel(ChannelPtr channel)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux) || defined(__linux__)
+	if (ring_fd_ < 0) {
+		return;
+	}
+
+	int fd = channel->GetSocket();
+	auto iter = channels_.find(fd);
+	if (iter != channels_.end()) {
+		ChannelEntry& entry = iter->second;
+		this->PollRemove(fd, entry);
+		if (channel->IsNoneEvent()) {
+			channels_.erase(iter);
+		}
+		else {
+			entry.channel = channel;
+			this->PollAdd(fd, entry);
+		}
+	}
+	else if (!channel->IsNoneEvent()) {
+		ChannelEntry& entry = channels_[fd];
+		entry.channel = channel;
+		this->PollAdd(fd, entry);
+	}
+
+	if (!this->IsInLoopThread()) {
+		this->Submit();
+	}
+#endif
+}
+
+void IoUringTaskScheduler::RemoveChannel(ChannelPtr& channel)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux) || defined(__linux__)
+	if (ring_fd_ < 0) {
+		return;
+	}
+
+	int fd = channel->GetSocket();
+	auto iter = channels_.find(fd);
+	if (iter != channels_.end()) {
+		this->PollRemove(fd, iter->second);
+		channels_.erase(iter);
+		if (!this->IsInLoopThread()) {
+			this->Submit();
+		}
+	}
+#endif
+}
+
+/*
+ܣ¼ѭ
+һ io_uring_enter ͬʱύܵ SQE ȴһ¼ʱ IORING_ENTER_EXT_ARG 룩
+ոɶкص ChannelصΪȻЧ Channel ύ POLL_ADD
+*/
+bool IoUringTaskScheduler::HandleEvent(int timeout)
+{
+#if defined(__linux) || defined(__linux__)
+	if (ring_fd_ < 0) {
+		return false;
+	}
+
+	loop_thread_id_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	unsigned to_submit = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		__atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+		to_submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+	}
+
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	unsigned min_complete = 0;
+	unsigned flags = 0;
+
+	if (timeout != 0) {
+		min_complete = 1;
+		flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+		if (timeout > 0) {
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+			arg.ts = (uint64_t)(uintptr_t)&ts;
+		}
+	}
+
+	int ret = IoUringEnter(ring_fd_, to_submit, min_complete, flags,
+		flags ? &arg : nullptr, flags ? sizeof(arg) : 0);
+	if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN) {
+		return false;
+	}
+
+	// ոɶУֻȻЧ¼
+	events_.clear();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		unsigned head = *cq_head_;
+		unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+			if (cqe->user_data == 0) {
+				continue;
+			}
+
+			int fd = (int)(cqe->user_data >> 32);
+			uint32_t generation = (uint32_t)cqe->user_data;
+			auto iter = channels_.find(fd);
+			if (iter == channels_.end() || iter->second.generation != generation || !iter->second.armed) {
+				continue;
+			}
+
+			iter->second.armed = false;
+			if (cqe->res == -ECANCELED) {
+				continue;
+			}
+
+			PollEvent event;
+			event.channel = iter->second.channel;
+			event.events = cqe->res >= 0 ? cqe->res : EVENT_ERR;
+			event.rearm = cqe->res >= 0;
+			events_.push_back(std::move(event));
+		}
+		__atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+	}
+
+	this->RecordWakeup((uint32_t)events_.size());
+	for (auto& event : events_) {
+		event.channel->HandleEvent(event.events);
+	}
+
+	// һ POLL_ADD ɺ¹أһ HandleEvent ȴһύ
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto& event : events_) {
+			if (!event.rearm) {
+				continue;
+			}
+			int fd = event.channel->GetSocket();
+			auto iter = channels_.find(fd);
+			if (iter != channels_.end() && iter->second.channel == event.channel
+				&& !iter->second.armed && !event.channel->IsNoneEvent()) {
+				this->PollAdd(fd, iter->second);
+			}
+		}
+	}
+	events_.clear();
+
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,101 @@
+#ifndef XOP_IO_URING_TASK_SCHEDULER_H
+#define XOP_IO_URING_TASK_SCHEDULER_H
+
+/*
+IoUringTaskScheduler ǻ Linux io_uring ľ֪ͨpollˣ EpollTaskScheduler ɻ滻
+io_uring ֻ epoll_ctl/epoll_waitrecv/send  TcpConnection ͬϵͳɣ
+û recv/send ύmultishot accept/recv  provided buffer ringЩҪӸΪʽ I/O
+
+ liburingֱʹ io_uring_setup/io_uring_enter ϵͳú͹ڴ滷
+ÿ Channel ӦһһԵ IORING_OP_POLL_ADDɺȻصٰ Channel ǰע¼ύ
+ύʱں˻״̬ˮƽ epoll һ£TcpConnection ÿֻһҲᶪ¼
+¼ѭ߳ڵ UpdateChannel/RemoveChannel ֻдύУһεȴϲΪһ io_uring_enter
+· EnableWriting/DisableWriting ٸԲһ epoll_ctl ϵͳã̵߳޸ύ
+user_data  fd ʹɣɾ޸ĵ Channel ٵ¼ᱻ
+
+Ҫں 5.11+IORING_FEAT_EXT_ARGȴʱʱ֧ʱ EventLoop Զ˵ epoll
+*/
+
+#include "TaskScheduler.h"
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace xop
+{
+
+class IoUringTaskScheduler : public TaskScheduler
+{
+public:
+	IoUringTaskScheduler(int id = 0, TimerQueueType timer_queue_type = TIMER_QUEUE_MAP, uint32_t timer_tick_us = 1000);
+	virtual ~IoUringTaskScheduler();
+
+	// ںǷ֧֣棩EventLoop ݴ˾Ƿ˵ epoll
+	static bool IsSupported();
+
+	// Ƿ񴴽ɹʧʱ EventLoop  epoll
+	bool IsReady() const
+	{ return ring_fd_ >= 0; }
+
+	void UpdateChannel(ChannelPtr channel);
+	void RemoveChannel(ChannelPtr& channel);
+
+	// timeout: ms
+	bool HandleEvent(int timeout);
+
+private:
+	struct ChannelEntry
+	{
+		ChannelPtr channel;
+		uint32_t generation = 0;
+		bool armed = false;			// Ƿδɵ POLL_ADD
+	};
+
+	struct PollEvent
+	{
+		ChannelPtr channel;
+		int events = 0;
+		bool rearm = true;			// ɵ POLL_ADD ύʧЧ fd ת
+	};
+
+	bool Setup();
+	void Teardown();
+	void* GetSqe();
+	void PollAdd(int fd, ChannelEntry& entry);
+	void PollRemove(int fd, ChannelEntry& entry);
+	void Submit();
+
+	static uint64_t MakeUserData(int fd, uint32_t generation)
+	{ return ((uint64_t)(uint32_t)fd << 32) | generation; }
+
+	static const uint32_t kRingEntries = 1024;
+
+	int ring_fd_ = -1;
+	void* sq_ring_ = nullptr;
+	void* cq_ring_ = nullptr;
+	void* sqes_ = nullptr;
+	size_t sq_ring_size_ = 0;
+	size_t cq_ring_size_ = 0;
+	size_t sqes_size_ = 0;
+
+	unsigned* sq_head_ = nullptr;
+	unsigned* sq_tail_ = nullptr;
+	unsigned* sq_mask_ = nullptr;
+	unsigned* sq_entries_ = nullptr;
+	unsigned* sq_array_ = nullptr;
+	unsigned* cq_head_ = nullptr;
+	unsigned* cq_tail_ = nullptr;
+	unsigned* cq_mask_ = nullptr;
+	void* cqes_ = nullptr;
+	unsigned sq_local_tail_ = 0;	// βָ룬Submit() ʱٷں
+
+	std::mutex mutex_;
+	std::unordered_map<int, ChannelEntry> channels_;
+	uint32_t generation_ = 0;
+	std::vector<PollEvent> events_;
+};
+
+}
+
+#endif
@@ -1,16 +1,22 @@
 // PHZ
 // 2018-5-15
 
-#if defined(WIN32) || defined(_WIN32) 
+#if defined(WIN32) || defined(_WIN32)
 #ifndef _CRT_SECURE_NO_WARNINGS
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 #endif
 
 #include "Logger.h"
-#include "Timestamp.h"
-#include <stdarg.h>
-#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+
+#if defined(__linux) || defined(__linux__)
+#include <unistd.h>
+#elif defined(WIN32) || defined(_WIN32)
+#include <io.h>
+#endif
 
 using namespace xop;
 
@@ -23,9 +29,91 @@ const char* Priority_To_String[] =
 	"ERROR"
 };
 
-Logger::Logger() 
+namespace xop
+{
+
+struct Logger::Record
+{
+	int64_t time_us;			// ϵͳʱ䣨΢룩
+	const char* file;			// Log2 ļ¼Ϊ nullptr
+	const char* func;
+	int line;
+	Priority priority;
+	uint32_t size;				// ĳ
+	uint32_t suppressed;		// ǰƵƶͬһõ
+	char* heap_text;			// ĳ kMaxLineSize ʱз䣬ɺ̨߳ͷ
+	char text[kMaxLineSize];
+};
+
+struct Logger::Staging
+{
+	explicit Staging(uint32_t slots)
+		: ring((int)slots), orphaned(false)
+	{ }
+
+	// Ƶƣʽֱַӳ䣬ͻʱǣֻƣඪ
+	struct RateEntry
+	{
+		const char* fmt = nullptr;
+		int64_t window = 0;		// 
+		uint32_t count = 0;
+		uint32_t suppressed = 0;
+	};
+
+	static const uint32_t kRateSlots = 64;
+
+	RingBuffer<Record> ring;
+	std::atomic<bool> orphaned;	// ߳˳ȡպɺ̨߳ͷ
+	RateEntry rates[kRateSlots];
+};
+
+/*
+t_staging/t_staging_released ƽ͵ thread_localᱻ
+ thread_local м¼־ʱԿɰȫʣʱ˻ͬд
+*/
+static thread_local Logger::Staging* t_staging = nullptr;
+static thread_local bool t_staging_released = false;
+
+struct StagingHolder
+{
+	bool active = false;
+
+	~StagingHolder()
+	{
+		if (t_staging != nullptr) {
+			t_staging->orphaned.store(true, std::memory_order_release);
+			t_staging = nullptr;
+		}
+		t_staging_released = true;
+	}
+};
+}
+
+static thread_local StagingHolder t_staging_holder;
+
+static int64_t GetSystemMicroseconds()
+{
+	auto time_point = std::chrono::system_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(time_point.time_since_epoch()).count();
+}
+
+static int64_t GetSteadyMilliseconds()
+{
+	auto time_point = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()).count();
+}
+
+Logger::Logger()
+	: rate_limit_(options_.rate_limit)
+	, running_(true)
+	, logged_(0)
+	, dropped_(0)
+	, suppressed_(0)
+	, batches_(0)
+	, bytes_(0)
+	, rotations_(0)
 {
-    
+	writer_ = std::thread(&Logger::Run, this);
 }
 
 Logger& Logger::Instance()
@@ -34,66 +122,433 @@ Logger& Logger::Instance()
 	return s_logger;
 }
 
+/*
+˳ʱдʣ־ݴ滷ⲻͷţܻ߳̿ t_staging
+*/
 Logger::~Logger()
 {
+	this->Exit();
 
+	for (auto& staging : stagings_) {
+		staging.release();
+	}
 }
 
 void Logger::Init(char *pathname)
 {
-	std::unique_lock<std::mutex> lock(mutex_);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
 
-	if (pathname != nullptr) {
-		ofs_.open(pathname, std::ios::out | std::ios::binary);
-		if (ofs_.fail())
-		{
-			std::cerr << "Failed to open logfile." << std::endl;
+		if (file_ != nullptr) {
+			fclose(file_);
+			file_ = nullptr;
+		}
+
+		if (pathname != nullptr) {
+			pathname_ = pathname;
+			file_ = fopen(pathname, "wb");
+			if (file_ == nullptr) {
+				fprintf(stderr, "Failed to open logfile.\n");
+			}
+			file_size_ = 0;
 		}
 	}
+
+	if (!running_.exchange(true)) {
+		writer_ = std::thread(&Logger::Run, this);
+	}
 }
 
 void Logger::Exit()
 {
-	std::unique_lock<std::mutex> lock(mutex_);
+	if (running_.exchange(false)) {
+		wakeup_.notify_one();
+		if (writer_.joinable()) {
+			writer_.join();
+		}
+	}
 
-	if (ofs_.is_open()) {
-		ofs_.close();
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (file_ != nullptr) {
+		fclose(file_);
+		file_ = nullptr;
 	}
 }
 
-void Logger::Log(Priority priority, const char* __file, const char* __func, int __line, const char *fmt, ...)
-{	
-	std::unique_lock<std::mutex> lock(mutex_);
+void Logger::SetOptions(const LoggerOptions& options)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	options_ = options;
+	if (options_.ring_slots == 0) {
+		options_.ring_slots = 1;
+	}
+	rate_limit_.store(options_.rate_limit, std::memory_order_relaxed);
+}
 
-	char buf[2048] = {0};
-	sprintf(buf, "[%s][%s:%s:%d] ", Priority_To_String[priority],  __file, __func, __line);
+LoggerStats Logger::GetStats()
+{
+	LoggerStats stats;
+	stats.logged = logged_.load(std::memory_order_relaxed);
+	stats.dropped = dropped_.load(std::memory_order_relaxed);
+	stats.suppressed = suppressed_.load(std::memory_order_relaxed);
+	stats.batches = batches_.load(std::memory_order_relaxed);
+	stats.bytes = bytes_.load(std::memory_order_relaxed);
+	stats.rotations = rotations_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void Logger::Log(Priority priority, const char* __file, const char* __func, int __line, const char *fmt, ...)
+{
 	va_list args;
 	va_start(args, fmt);
-	vsprintf(buf + strlen(buf), fmt, args);
+	this->Append(priority, __file, __func, __line, fmt, args);
 	va_end(args);
-	this->Write(std::string(buf));
 }
 
 void Logger::Log2(Priority priority, const char *fmt, ...)
 {
-	std::unique_lock<std::mutex> lock(mutex_);
-
-	char buf[4096] = { 0 };
-	sprintf(buf, "[%s] ", Priority_To_String[priority]);  
 	va_list args;
 	va_start(args, fmt);
-	vsprintf(buf + strlen(buf), fmt, args);
+	this->Append(priority, nullptr, nullptr, 0, fmt, args);
 	va_end(args);
-	this->Write(std::string(buf));
 }
 
-void Logger::Write(std::string info)
+Logger::Staging* Logger::GetStaging()
+{
+	if (t_staging == nullptr && !t_staging_released) {
+		t_staging_holder.active = true;	// ״ʹʱ죬߳˳ʱ
+		std::lock_guard<std::mutex> lock(mutex_);
+		stagings_.emplace_back(new Staging(options_.ring_slots));
+		t_staging = stagings_.back().get();
+	}
+
+	return t_staging;
+}
+
+/*
+̣߳Ƶƣڱ߳ݴ滷ĲλֱӸʽģ軽Ѻ̨̡߳
+ʱ͵λԭ棬ǰ׺ɺ̨߳ƴӡ
+*/
+void Logger::Append(Priority priority, const char* file, const char* func, int line, const char* fmt, va_list args)
+{
+	Staging* staging = running_.load(std::memory_order_relaxed) ? this->GetStaging() : nullptr;
+	if (staging == nullptr) {
+		this->WriteSync(priority, file, func, line, fmt, args);
+		return;
+	}
+
+	int64_t now = GetSystemMicroseconds();
+	uint32_t suppressed = 0;
+	uint32_t rate_limit = rate_limit_.load(std::memory_order_relaxed);
+	if (rate_limit > 0) {
+		Staging::RateEntry& entry = staging->rates[((uintptr_t)fmt >> 3) % Staging::kRateSlots];
+		int64_t window = now / 1000000;
+		if (entry.fmt != fmt || entry.window != window) {
+			if (entry.fmt == fmt) {
+				suppressed = entry.suppressed;
+			}
+			entry.fmt = fmt;
+			entry.window = window;
+			entry.count = 0;
+			entry.suppressed = 0;
+		}
+
+		entry.count += 1;
+		if (entry.count > rate_limit) {
+			entry.suppressed += 1;
+			suppressed_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	Record* record = staging->ring.BeginPush();
+	if (record == nullptr) {
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+		wakeup_.notify_one();
+		return;
+	}
+
+	record->time_us = now;
+	record->file = file;
+	record->func = func;
+	record->line = line;
+	record->priority = priority;
+	record->suppressed = suppressed;
+	record->heap_text = nullptr;
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int size = vsnprintf(record->text, kMaxLineSize, fmt, args);
+	if (size >= (int)kMaxLineSize) {
+		record->heap_text = (char*)malloc((size_t)size + 1);
+		if (record->heap_text != nullptr) {
+			vsnprintf(record->heap_text, (size_t)size + 1, fmt, args_copy);
+		}
+		else {
+			size = kMaxLineSize - 1;
+		}
+	}
+	va_end(args_copy);
+	record->size = size > 0 ? (uint32_t)size : 0;
+
+	staging->ring.CommitPush();
+
+	if (priority >= LOG_ERROR || staging->ring.Size() * 2 >= staging->ring.Capacity()) {
+		wakeup_.notify_one();
+	}
+}
+
+/*
+̨߳δл߳˳ʱֱд mutex_
+*/
+void Logger::WriteSync(Priority priority, const char* file, const char* func, int line, const char* fmt, va_list args)
+{
+	Record record;
+	record.time_us = GetSystemMicroseconds();
+	record.file = file;
+	record.func = func;
+	record.line = line;
+	record.priority = priority;
+	record.suppressed = 0;
+	record.heap_text = nullptr;
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int size = vsnprintf(record.text, kMaxLineSize, fmt, args);
+	std::string text;
+	if (size >= (int)kMaxLineSize) {
+		text.resize((size_t)size + 1);
+		vsnprintf(&text[0], text.size(), fmt, args_copy);
+		record.heap_text = &text[0];
+	}
+	va_end(args_copy);
+	record.size = size > 0 ? (uint32_t)size : 0;
+
+	char time[32] = { 0 };
+	FormatTime(record.time_us / 1000000, time, sizeof(time));
+	std::string out;
+	FormatRecord(record, time, out);
+	this->Flush(out, priority >= LOG_ERROR);
+}
+
+/*
+̨̣߳ȴ flush_interval_ms 򱻻ѣϲдݴ滷ֹͣʱдһΣȷβ
+*/
+void Logger::Run()
+{
+	while (running_.load(std::memory_order_acquire)) {
+		uint32_t interval = 50;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			interval = options_.flush_interval_ms > 0 ? options_.flush_interval_ms : 1;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(wakeup_mutex_);
+			wakeup_.wait_for(lock, std::chrono::milliseconds(interval));
+		}
+
+		this->Drain();
+	}
+
+	this->Drain();
+}
+
+/*
+ʱϲ̵߳ݴ滷ÿѰʱ򣩣ʽ batch_ д
+ 1MB дһΣ־籩ʱ˳̵߳ݴ滷ȡպͷš
+*/
+void Logger::Drain()
 {
-	if (ofs_.is_open()) {
-		ofs_ << "[" << Timestamp::Localtime() << "]"
-			<< info << std::endl;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		draining_.clear();
+		for (auto iter = stagings_.begin(); iter != stagings_.end(); ) {
+			Staging* staging = iter->get();
+			if (staging->orphaned.load(std::memory_order_acquire) && staging->ring.IsEmpty()) {
+				iter = stagings_.erase(iter);
+				continue;
+			}
+			draining_.push_back(staging);
+			++iter;
+		}
+	}
+
+	batch_.clear();
+	bool has_error = false;
+
+	uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+	if (dropped != reported_dropped_) {
+		char text[128] = { 0 };
+		snprintf(text, sizeof(text), "%llu log messages dropped, staging ring full",
+			(unsigned long long)(dropped - reported_dropped_));
+		reported_dropped_ = dropped;
+
+		Record record;
+		record.time_us = GetSystemMicroseconds();
+		record.file = nullptr;
+		record.priority = LOG_WARNING;
+		record.suppressed = 0;
+		record.heap_text = text;
+		record.size = (uint32_t)strlen(text);
+		FormatTime(record.time_us / 1000000, cached_time_, sizeof(cached_time_));
+		cached_second_ = record.time_us / 1000000;
+		FormatRecord(record, cached_time_, batch_);
+	}
+
+	while (true) {
+		Staging* best = nullptr;
+		Record* best_record = nullptr;
+		for (Staging* staging : draining_) {
+			Record* record = staging->ring.Front();
+			if (record != nullptr && (best_record == nullptr || record->time_us < best_record->time_us)) {
+				best = staging;
+				best_record = record;
+			}
+		}
+
+		if (best == nullptr) {
+			break;
+		}
+
+		int64_t second = best_record->time_us / 1000000;
+		if (second != cached_second_) {
+			FormatTime(second, cached_time_, sizeof(cached_time_));
+			cached_second_ = second;
+		}
+
+		FormatRecord(*best_record, cached_time_, batch_);
+		has_error = has_error || best_record->priority >= LOG_ERROR;
+		if (best_record->heap_text != nullptr) {
+			free(best_record->heap_text);
+			best_record->heap_text = nullptr;
+		}
+		best->ring.CommitPop();
+
+		if (batch_.size() >= 1024 * 1024) {
+			this->Flush(batch_, has_error);
+			batch_.clear();
+			has_error = false;
+		}
+	}
+
+	if (!batch_.empty()) {
+		this->Flush(batch_, has_error);
+	}
+}
+
+/*
+һ־һ fwrite + fflushļ sync_interval_ms ERROR ʱfdatasync max_file_size ʱת
+*/
+void Logger::Flush(const std::string& data, bool has_error)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (options_.console) {
+		fwrite(data.data(), 1, data.size(), stdout);
+		fflush(stdout);
+	}
+
+	for (size_t pos = data.find('\n'); pos != std::string::npos; pos = data.find('\n', pos + 1)) {
+		logged_.fetch_add(1, std::memory_order_relaxed);
+	}
+	batches_.fetch_add(1, std::memory_order_relaxed);
+
+	if (file_ == nullptr) {
+		return;
+	}
+
+	fwrite(data.data(), 1, data.size(), file_);
+	fflush(file_);
+	file_size_ += data.size();
+	bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+
+	int64_t now = GetSteadyMilliseconds();
+	if ((has_error && options_.sync_on_error)
+		|| (options_.sync_interval_ms > 0 && now - last_sync_ms_ >= (int64_t)options_.sync_interval_ms)) {
+#if defined(__linux) || defined(__linux__)
+		fdatasync(fileno(file_));
+#elif defined(WIN32) || defined(_WIN32)
+		_commit(_fileno(file_));
+#endif
+		last_sync_ms_ = now;
+	}
+
+	if (options_.max_file_size > 0 && file_size_ >= options_.max_file_size) {
+		this->Rotate();
+	}
+}
+
+/*
+path -> path.1 -> path.2 ... path.Nɵıǣ÷ mutex_
+*/
+void Logger::Rotate()
+{
+	fclose(file_);
+	file_ = nullptr;
+
+	if (options_.max_files > 0) {
+		for (uint32_t n = options_.max_files - 1; n > 0; n--) {
+			std::string from = pathname_ + "." + std::to_string(n);
+			std::string to = pathname_ + "." + std::to_string(n + 1);
+			remove(to.c_str());
+			rename(from.c_str(), to.c_str());
+		}
+		std::string first = pathname_ + ".1";
+		remove(first.c_str());
+		rename(pathname_.c_str(), first.c_str());
+	}
+
+	file_ = fopen(pathname_.c_str(), "wb");
+	file_size_ = 0;
+	rotations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Logger::FormatTime(int64_t seconds, char* buf, size_t size)
+{
+	time_t tt = (time_t)seconds;
+	struct tm tm;
+#if defined(WIN32) || defined(_WIN32)
+	localtime_s(&tm, &tt);
+#else
+	localtime_r(&tt, &tm);
+#endif
+	strftime(buf, size, "%F %T", &tm);
+}
+
+/*
+[ʱ][] ģ [ʱ][][ļ::] ģĩβĻֻһ
+*/
+void Logger::FormatRecord(const Record& record, const char* time, std::string& out)
+{
+	char prefix[512] = { 0 };
+	int size = 0;
+	if (record.file != nullptr) {
+		size = snprintf(prefix, sizeof(prefix), "[%s][%s][%s:%s:%d] ", time, Priority_To_String[record.priority],
+			record.file, record.func, record.line);
+	}
+	else {
+		size = snprintf(prefix, sizeof(prefix), "[%s][%s] ", time, Priority_To_String[record.priority]);
+	}
+	if (size > (int)sizeof(prefix) - 1) {
+		size = (int)sizeof(prefix) - 1;
+	}
+	out.append(prefix, size > 0 ? (size_t)size : 0);
+
+	const char* text = record.heap_text != nullptr ? record.heap_text : record.text;
+	uint32_t text_size = record.size;
+	if (record.heap_text == nullptr && text_size > kMaxLineSize - 1) {
+		text_size = kMaxLineSize - 1;
+	}
+	while (text_size > 0 && (text[text_size - 1] == '\n' || text[text_size - 1] == '\r')) {
+		text_size -= 1;
+	}
+	out.append(text, text_size);
+
+	if (record.suppressed > 0) {
+		out.append(" (");
+		out.append(std::to_string(record.suppressed));
+		out.append(" similar messages suppressed)");
 	}
-   
-	std::cout << "[" << Timestamp::Localtime() << "]"
-			<< info << std::endl;
+	out.push_back('\n');
 }
@@ -4,53 +4,153 @@
 #ifndef XOP_LOGGER_H
 #define XOP_LOGGER_H
 
-#include <string>
-#include <mutex>
-#include <thread>
-#include <fstream>
+/*
+첽־ֻ߳ʱ䡢𡢵λú͸ʽд뱾̵߳ݴ滷ߵߣ
+ɺ̨̰߳ʱϲ̵߳ݴ滷дļͱ׼÷ټȫÿ flush
+
+ݴ滷ʱͱ̣߳ERROR ݴ滷ʱѺ̨̣߳ flush_interval_ms д
+ͬһõ㣨ʽÿ볬 rate_limit ʱģһ¼ϱƵ̼߳ƣ
+ļ max_file_size ʱתΪ path.1 .. path.N
+XOP_LOG_LEVEL ڱڹˣڸü LOG_* չΪգᱻֵ
+̨߳δУExit() ֮󡢽˳׶Σʱ˻ͬд
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
 
 namespace xop {
 
 
-enum Priority 
+enum Priority
 {
     LOG_DEBUG, LOG_STATE, LOG_INFO, LOG_WARNING, LOG_ERROR,
-};	
-	
+};
+
+struct LoggerOptions
+{
+	bool console = true;						// ͬʱ׼
+	uint32_t flush_interval_ms = 50;			// ̨߳дһ
+	uint32_t sync_interval_ms = 1000;			// ־ļ fdatasync С0 ʾͬ
+	bool sync_on_error = true;					//  ERROR ʱͬ
+	uint64_t max_file_size = 64 * 1024 * 1024;	// ת0 ʾת
+	uint32_t max_files = 5;						// ʷļ
+	uint32_t rate_limit = 200;					// ͬһõÿ¼ỵ̈߳0 ʾ
+	uint32_t ring_slots = 256;					// ֮½̵߳ݴ滷λ
+};
+
+struct LoggerStats
+{
+	uint64_t logged = 0;		// д־
+	uint64_t dropped = 0;		// ݴ滷
+	uint64_t suppressed = 0;	// Ƶƶ
+	uint64_t batches = 0;		// ̨߳д
+	uint64_t bytes = 0;			// дļֽ
+	uint64_t rotations = 0;		// ļת
+};
+
 class Logger
 {
 public:
 	Logger &operator=(const Logger &) = delete;
-	Logger(const Logger &) = delete;	
+	Logger(const Logger &) = delete;
 	static Logger& Instance();
 	~Logger();
 
+	// ־ļpathname Ϊʱֻ׼̨߳δʱ
 	void Init(char *pathname = nullptr);
+	// дݴ־ֹ̨̲ͣ߳رļ֮־ͬд
 	void Exit();
 
+	void SetOptions(const LoggerOptions& options);
+	LoggerStats GetStats();
+
 	void Log(Priority priority, const char* __file, const char* __func, int __line, const char *fmt, ...);
 	void Log2(Priority priority, const char *fmt, ...);
 
+	struct Record;
+	struct Staging;
+
 private:
-	void Write(std::string buf);
 	Logger();
 
-	std::mutex mutex_;
-	std::ofstream ofs_;
+	void Append(Priority priority, const char* file, const char* func, int line, const char* fmt, va_list args);
+	Staging* GetStaging();
+	void WriteSync(Priority priority, const char* file, const char* func, int line, const char* fmt, va_list args);
+	void Run();
+	void Drain();
+	void Flush(const std::string& data, bool has_error);
+	void Rotate();
+	static void FormatTime(int64_t seconds, char* buf, size_t size);
+	static void FormatRecord(const Record& record, const char* time, std::string& out);
+
+	static const uint32_t kMaxLineSize = 480;	// ݴ滷ĳȣз
+
+	std::mutex mutex_;							//  stagings_ļѡ
+	std::vector<std::unique_ptr<Staging>> stagings_;
+	LoggerOptions options_;
+	std::string pathname_;
+	FILE* file_ = nullptr;
+	uint64_t file_size_ = 0;
+	int64_t last_sync_ms_ = 0;
+
+	std::atomic<uint32_t> rate_limit_;			// options_.rate_limit߳ȡ
+	std::atomic<bool> running_;
+	std::thread writer_;
+	std::mutex wakeup_mutex_;
+	std::condition_variable wakeup_;			// Ѻֻ̨̣߳ ERROR ݴ滷ʱ֪ͨ
+	std::string batch_;							// ̵̨߳
+	std::vector<Staging*> draining_;			// ֺ̨̱߳ϲݴ滷
+	int64_t cached_second_ = -1;				// ʽʱ䣨룩
+	char cached_time_[32] = { 0 };
+	uint64_t reported_dropped_ = 0;				// дʾĶ
+
+	std::atomic<uint64_t> logged_;
+	std::atomic<uint64_t> dropped_;
+	std::atomic<uint64_t> suppressed_;
+	std::atomic<uint64_t> batches_;
+	std::atomic<uint64_t> bytes_;
+	std::atomic<uint64_t> rotations_;
 };
- 
+
 }
 
+// ־𣺵ڸü־չΪ
+#ifndef XOP_LOG_LEVEL
 #ifdef _DEBUG
+#define XOP_LOG_LEVEL 0		// LOG_DEBUG
+#else
+#define XOP_LOG_LEVEL 2		// LOG_INFO
+#endif
+#endif
+
+#if XOP_LOG_LEVEL <= 0
 #define LOG_DEBUG(fmt, ...) xop::Logger::Instance().Log(LOG_DEBUG, __FILE__, __FUNCTION__,__LINE__, fmt, ##__VA_ARGS__)
 #else
 #define LOG_DEBUG(fmt, ...)
 #endif
+#if XOP_LOG_LEVEL <= 2
 #define LOG_INFO(fmt, ...) xop::Logger::Instance().Log2(LOG_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...)
+#endif
+#if XOP_LOG_LEVEL <= 3
+#define LOG_WARNING(fmt, ...) xop::Logger::Instance().Log2(LOG_WARNING, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(fmt, ...)
+#endif
 #define LOG_ERROR(fmt, ...) xop::Logger::Instance().Log(LOG_ERROR, __FILE__, __FUNCTION__,__LINE__, fmt, ##__VA_ARGS__)
 
 #endif
-
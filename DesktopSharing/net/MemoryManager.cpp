@@ -2,6 +2,9 @@
 
 using namespace xop;
 
+static const uint32_t kLargeClass = 0xffffffff;	// ͷеķּ malloc 䣬ͷʱֱ free
+static const uint32_t kSlabSize = 256 * 1024;
+
 void* xop::Alloc(uint32_t size)
 {
 	return MemoryManager::Instance().Alloc(size);
@@ -12,115 +15,316 @@ void xop::Free(void *ptr)
 	return MemoryManager::Instance().Free(ptr);
 }
 
-MemoryPool::MemoryPool()
+/*
+̻߳棺ֻ߳޸ģͳƼ relaxed ԭӱGetStats() ̶߳ȡ
+± kNumClasses ͳƳּķ䡣
+*/
+struct MemoryManager::ThreadCache
 {
+	std::vector<void*> blocks[kNumClasses];
+	std::atomic<uint64_t> allocs[kNumClasses + 1];
+	std::atomic<uint64_t> hits[kNumClasses + 1];
+	std::atomic<uint64_t> fallbacks[kNumClasses + 1];
+
+	ThreadCache()
+	{
+		for (uint32_t n = 0; n <= kNumClasses; n++) {
+			allocs[n] = 0;
+			hits[n] = 0;
+			fallbacks[n] = 0;
+		}
+	}
+
+	static void Increase(std::atomic<uint64_t>& counter)
+	{ counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+};
+
+/*
+߳˳ʱѻĿ黹Ĳֿ⡣
+t_cache/t_cache_released ƽ͵ thread_localᱻ thread_local ͷڴʱԿɰȫʡ
+*/
+static thread_local MemoryManager::ThreadCache* t_cache = nullptr;
+static thread_local bool t_cache_released = false;
 
+namespace xop
+{
+struct ThreadCacheHolder
+{
+	bool active = false;
+
+	~ThreadCacheHolder()
+	{
+		if (t_cache != nullptr) {
+			MemoryManager::Instance().ReleaseThreadCache(t_cache);
+			t_cache = nullptr;
+		}
+		t_cache_released = true;
+	}
+};
 }
 
-MemoryPool::~MemoryPool()
+static thread_local ThreadCacheHolder t_cache_holder;
+
+static uint32_t GetClassId(uint32_t size)
 {
-	if (memory_) {
-		free(memory_);
+	uint32_t n = size + MemoryManager::kHeaderSize;
+	uint32_t class_id = 0;
+	while ((1u << (class_id + MemoryManager::kMinClassShift)) < n) {
+		class_id += 1;
+		if (class_id >= MemoryManager::kNumClasses) {
+			return kLargeClass;
+		}
 	}
+	return class_id;
 }
 
-void MemoryPool::Init(uint32_t size, uint32_t n)
+MemoryManager::MemoryManager()
 {
-	if (memory_) {
-		return;
+	for (uint32_t n = 0; n < kNumClasses; n++) {
+		Depot& depot = depots_[n];
+		depot.block_size = 1u << (n + kMinClassShift);
+		depot.blocks_per_slab = depot.block_size < kSlabSize ? kSlabSize / depot.block_size : 1;
 	}
 
-	block_size_ = size;
-	num_blocks_ = n;
-	memory_ = (char*)malloc(num_blocks_ * (block_size_ + sizeof(MemoryBlock)));
-	head_ = (MemoryBlock*)memory_;
-	head_->block_id = 1;
-	head_->pool = this;
-	head_->next = nullptr;
+	SetOptions(MemoryOptions());
+}
 
-	MemoryBlock* current = head_;
-	for (uint32_t n = 1; n < num_blocks_; n++) {
-		MemoryBlock* next = (MemoryBlock*)(memory_ + (n * (block_size_ + sizeof(MemoryBlock))));
-		next->block_id = n + 1;
-		next->pool = this;
-		next->next = nullptr;
+/*
+ᱻ Instance()ﲻͷ slab
+*/
+MemoryManager::~MemoryManager()
+{
 
-		current->next = next;
-		current = next;
-	}
 }
 
-void* MemoryPool::Alloc(uint32_t size)
+/*
+ⲻ̬߳˳ʱܻͷڴ档
+*/
+MemoryManager& MemoryManager::Instance()
 {
-	std::lock_guard<std::mutex> locker(mutex_);
-	if (head_ != nullptr) {
-		MemoryBlock* block = head_;
-		head_ = head_->next;
-		return ((char*)block + sizeof(MemoryBlock));
+	static MemoryManager* s_mgr = new MemoryManager;
+	return *s_mgr;
+}
+
+void MemoryManager::SetOptions(const MemoryOptions& options)
+{
+	for (uint32_t n = 0; n < kNumClasses; n++) {
+		Depot& depot = depots_[n];
+		uint32_t batch = options.thread_cache_bytes / 2 / depot.block_size;
+		depot.batch = batch > 0 ? batch : 1;
+		depot.cached = batch > 0;
+
+		std::lock_guard<std::mutex> locker(depot.mutex);
+		depot.max_bytes = options.max_bytes_per_class;
 	}
+}
 
-	return nullptr;
+void MemoryManager::SetCapacity(uint32_t size, uint64_t max_bytes)
+{
+	uint32_t class_id = GetClassId(size);
+	if (class_id != kLargeClass) {
+		std::lock_guard<std::mutex> locker(depots_[class_id].mutex);
+		depots_[class_id].max_bytes = max_bytes;
+	}
 }
 
-void MemoryPool::Free(void* ptr)
+MemoryManager::ThreadCache* MemoryManager::GetThreadCache()
 {
-	MemoryBlock *block = (MemoryBlock*)((char*)ptr - sizeof(MemoryBlock));
-	if (block->block_id != 0) {
-		std::lock_guard<std::mutex> locker(mutex_);
-		block->next = head_;
-		head_ = block;
+	if (t_cache == nullptr && !t_cache_released) {
+		t_cache_holder.active = true;	// ״ʹʱ죬߳˳ʱ
+		t_cache = new ThreadCache;
+		std::lock_guard<std::mutex> locker(caches_mutex_);
+		caches_.push_back(t_cache);
 	}
+
+	return t_cache;
 }
 
-MemoryManager::MemoryManager()
+void MemoryManager::ReleaseThreadCache(ThreadCache* cache)
 {
-	memory_pools_[0].Init(4096, 50);
-	memory_pools_[1].Init(40960, 10);
-	memory_pools_[2].Init(102400, 5);
-	//memory_pools_[3].Init(204800, 2);
+	for (uint32_t n = 0; n < kNumClasses; n++) {
+		Return(n, cache->blocks[n], (uint32_t)cache->blocks[n].size());
+	}
+
+	std::lock_guard<std::mutex> locker(caches_mutex_);
+	for (uint32_t n = 0; n <= kNumClasses; n++) {
+		retired_allocs_[n] += cache->allocs[n];
+		retired_hits_[n] += cache->hits[n];
+		retired_fallbacks_[n] += cache->fallbacks[n];
+	}
+	for (auto iter = caches_.begin(); iter != caches_.end(); ++iter) {
+		if (*iter == cache) {
+			caches_.erase(iter);
+			break;
+		}
+	}
+	delete cache;
 }
 
-MemoryManager::~MemoryManager()
+/*
+Ĳֿȡһ blocksֿΪδﵽʱһ slabȡĿ
+*/
+uint32_t MemoryManager::Refill(uint32_t class_id, std::vector<void*>& blocks)
 {
+	Depot& depot = depots_[class_id];
+	std::lock_guard<std::mutex> locker(depot.mutex);
+
+	if (depot.blocks.empty()) {
+		uint64_t slab_bytes = (uint64_t)depot.block_size * depot.blocks_per_slab;
+		if (depot.bytes_held + slab_bytes > depot.max_bytes) {
+			return 0;
+		}
+
+		char* slab = (char*)malloc(slab_bytes);
+		if (slab == nullptr) {
+			return 0;
+		}
 
+		depot.slabs.push_back(slab);
+		depot.bytes_held += slab_bytes;
+		for (uint32_t n = depot.blocks_per_slab; n > 0; n--) {
+			depot.blocks.push_back(slab + (n - 1) * depot.block_size);
+		}
+	}
+
+	uint32_t count = depot.batch;
+	if (count > depot.blocks.size()) {
+		count = (uint32_t)depot.blocks.size();
+	}
+	blocks.insert(blocks.end(), depot.blocks.end() - count, depot.blocks.end());
+	depot.blocks.resize(depot.blocks.size() - count);
+	return count;
 }
 
-MemoryManager& MemoryManager::Instance()
+/*
+ blocks ĩβ count 黹Ĳֿ⡣
+*/
+void MemoryManager::Return(uint32_t class_id, std::vector<void*>& blocks, uint32_t count)
 {
-	static MemoryManager s_mgr;
-	return s_mgr;
+	if (count == 0) {
+		return;
+	}
+
+	Depot& depot = depots_[class_id];
+	std::lock_guard<std::mutex> locker(depot.mutex);
+	depot.blocks.insert(depot.blocks.end(), blocks.end() - count, blocks.end());
+	blocks.resize(blocks.size() - count);
 }
 
 void* MemoryManager::Alloc(uint32_t size)
 {
-	for (int n = 0; n < kMaxMemoryPool; n++) {
-		if (size <= memory_pools_[n].BolckSize()) {
-			void* ptr = memory_pools_[n].Alloc(size);
-			if (ptr != nullptr) {
-				return ptr;
-			}				
+	uint32_t class_id = GetClassId(size);
+	ThreadCache* cache = GetThreadCache();
+	char* block = nullptr;
+
+	if (class_id != kLargeClass) {
+		if (cache != nullptr) {
+			ThreadCache::Increase(cache->allocs[class_id]);
+			std::vector<void*>& blocks = cache->blocks[class_id];
+			if (!blocks.empty()) {
+				ThreadCache::Increase(cache->hits[class_id]);
+			}
 			else {
-				break;
+				Refill(class_id, blocks);
+			}
+
+			if (!blocks.empty()) {
+				block = (char*)blocks.back();
+				blocks.pop_back();
 			}
 		}
-	} 
+		else {
+			// ̻߳ͷţ߳˳׶ΣֱӴĲֿȡһ
+			std::vector<void*> blocks;
+			if (Refill(class_id, blocks) > 0) {
+				block = (char*)blocks.back();
+				blocks.pop_back();
+				Return(class_id, blocks, (uint32_t)blocks.size());
+			}
+		}
+	}
+	else if (cache != nullptr) {
+		ThreadCache::Increase(cache->allocs[kNumClasses]);
+	}
+
+	if (block != nullptr) {
+		*(uint32_t*)block = class_id;
+		return block + kHeaderSize;
+	}
 
-	MemoryBlock *block = (MemoryBlock*)malloc(size + sizeof(MemoryBlock));
-	block->block_id = 0;
-	block->pool = nullptr;
-	block->next = nullptr;
-	return ((char*)block + sizeof(MemoryBlock));
+	// ּּ
+	if (cache != nullptr) {
+		uint32_t index = kNumClasses;
+		if (class_id != kLargeClass) {
+			index = class_id;
+		}
+		ThreadCache::Increase(cache->fallbacks[index]);
+	}
+
+	block = (char*)malloc(size + kHeaderSize);
+	if (block == nullptr) {
+		return nullptr;
+	}
+	*(uint32_t*)block = kLargeClass;
+	return block + kHeaderSize;
 }
 
 void MemoryManager::Free(void* ptr)
 {
-	MemoryBlock *block = (MemoryBlock*)((char*)ptr - sizeof(MemoryBlock));
-	MemoryPool *pool = block->pool;
-	
-	if (pool != nullptr && block->block_id > 0) {
-		pool->Free(ptr);
+	if (ptr == nullptr) {
+		return;
 	}
-	else {
+
+	char* block = (char*)ptr - kHeaderSize;
+	uint32_t class_id = *(uint32_t*)block;
+	if (class_id == kLargeClass) {
 		::free(block);
+		return;
+	}
+
+	ThreadCache* cache = GetThreadCache();
+	if (cache == nullptr || !depots_[class_id].cached) {
+		std::vector<void*> blocks(1, block);
+		Return(class_id, blocks, 1);
+		return;
+	}
+
+	// ʱһĲֿ⣬һ
+	std::vector<void*>& blocks = cache->blocks[class_id];
+	blocks.push_back(block);
+	uint32_t batch = depots_[class_id].batch;
+	if (blocks.size() > 2 * batch) {
+		Return(class_id, blocks, batch);
+	}
+}
+
+std::vector<MemoryClassStats> MemoryManager::GetStats()
+{
+	std::vector<MemoryClassStats> stats(kNumClasses + 1);
+
+	{
+		std::lock_guard<std::mutex> locker(caches_mutex_);
+		for (uint32_t n = 0; n <= kNumClasses; n++) {
+			stats[n].allocs = retired_allocs_[n];
+			stats[n].cache_hits = retired_hits_[n];
+			stats[n].fallbacks = retired_fallbacks_[n];
+		}
+
+		for (ThreadCache* cache : caches_) {
+			for (uint32_t n = 0; n <= kNumClasses; n++) {
+				stats[n].allocs += cache->allocs[n].load(std::memory_order_relaxed);
+				stats[n].cache_hits += cache->hits[n].load(std::memory_order_relaxed);
+				stats[n].fallbacks += cache->fallbacks[n].load(std::memory_order_relaxed);
+			}
+		}
 	}
+
+	for (uint32_t n = 0; n < kNumClasses; n++) {
+		std::lock_guard<std::mutex> locker(depots_[n].mutex);
+		stats[n].block_size = depots_[n].block_size;
+		stats[n].bytes_held = depots_[n].bytes_held;
+		stats[n].depot_blocks = depots_[n].blocks.size();
+	}
+
+	return stats;
 }
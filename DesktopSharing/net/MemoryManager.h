@@ -4,7 +4,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace xop
 {
@@ -12,50 +15,95 @@ namespace xop
 void* Alloc(uint32_t size);
 void Free(void *ptr);
 
-class MemoryPool;
+// üĻһͷʱ黹 MemoryManager
+template<typename T = char>
+std::shared_ptr<T> AllocShared(uint32_t size)
+{
+	return std::shared_ptr<T>((T*)Alloc(size), [](T* ptr) { Free(ptr); });
+}
+
+/*
+Сּ slab 
+ÿּ64B..16MB2 ݣ RTP ͻƵ֡һĲֿ⣬ϵͳһһ slab гɵȴĿ飻
+ÿ߳ԼĻ棬ͷ̻߳ɣ˻ʱĲֿ⽻
+̻߳һ루Ĭ 128KB ϣҪƵ֡ʱ̻߳棬ͷʱֱӻĲֿ⣬
+ڷ߳Զڻ̷߳ȡ
+ּڴﵽޡ󳬹ּʱ˻ص malloc/free
+*/
 
-struct MemoryBlock
+struct MemoryOptions
 {
-	uint32_t block_id = 0;
-	MemoryPool *pool = nullptr;
-	MemoryBlock *next = nullptr;
+	uint64_t max_bytes_per_class = 16 * 1024 * 1024;	// ÿּ slab ֽ
+	uint32_t thread_cache_bytes = 256 * 1024;			// ÿ̻߳浥ּֽޣһΪ
 };
 
-class MemoryPool
+// ּͳƣblock_size Ϊ 0 ʾֱּ malloc ķ
+struct MemoryClassStats
 {
-public:
-	MemoryPool();
-	virtual ~MemoryPool();
+	uint32_t block_size = 0;
+	uint64_t allocs = 0;		// 
+	uint64_t cache_hits = 0;	// ֱ̻߳Ĵ
+	uint64_t fallbacks = 0;		// ˻ص malloc Ĵ
+	uint64_t bytes_held = 0;	//  slab ֽ
+	uint64_t depot_blocks = 0;	// ĲֿеĿп
 
-	void  Init(uint32_t size, uint32_t n);
-	void* Alloc(uint32_t size);
-	void  Free(void* ptr);
-
-	size_t BolckSize() const
-	{ return block_size_; }
-
-//private:
-	char* memory_ = nullptr;
-	uint32_t block_size_ = 0;
-	uint32_t num_blocks_ = 0;
-	MemoryBlock* head_ = nullptr;
-	std::mutex mutex_;
+	double HitRate() const
+	{ return allocs > 0 ? (double)cache_hits / (double)allocs : 0.0; }
 };
 
 class MemoryManager
 {
 public:
 	static MemoryManager& Instance();
-	~MemoryManager();
 
 	void* Alloc(uint32_t size);
 	void  Free(void* ptr);
 
+	// ޸̻߳СѻĿ鲻Ӱ
+	void SetOptions(const MemoryOptions& options);
+	//  size ֽڵķּ
+	void SetCapacity(uint32_t size, uint64_t max_bytes);
+
+	std::vector<MemoryClassStats> GetStats();
+
+	static const uint32_t kHeaderSize = 16;		// ͷ¼ּ֤صַ 16 ֽڶ
+	static const uint32_t kMinClassShift = 6;	// Сּ 64B
+	static const uint32_t kMaxClassShift = 24;	// ּ 16MBĹؼ֡
+	static const uint32_t kNumClasses = kMaxClassShift - kMinClassShift + 1;
+
+	struct ThreadCache;
+
 private:
 	MemoryManager();
+	~MemoryManager();
+
+	struct Depot
+	{
+		std::mutex mutex;
+		uint32_t block_size = 0;
+		uint32_t blocks_per_slab = 0;
+		std::atomic<uint32_t> batch{ 1 };
+		std::atomic<bool> cached{ true };	// Ƿ񾭹̻߳
+		uint64_t max_bytes = 0;
+		uint64_t bytes_held = 0;
+		std::vector<void*> blocks;	// п飨ָͷ
+		std::vector<char*> slabs;
+	};
+
+	ThreadCache* GetThreadCache();
+	void ReleaseThreadCache(ThreadCache* cache);
+	uint32_t Refill(uint32_t class_id, std::vector<void*>& blocks);
+	void Return(uint32_t class_id, std::vector<void*>& blocks, uint32_t count);
+
+	friend struct ThreadCacheHolder;
+
+	Depot depots_[kNumClasses];
 
-	static const int kMaxMemoryPool = 3;
-	MemoryPool memory_pools_[kMaxMemoryPool];
+	std::mutex caches_mutex_;
+	std::vector<ThreadCache*> caches_;		// ̵߳Ļ棬ڻͳ
+	uint64_t retired_allocs_[kNumClasses + 1] = { 0 };		// ˳̵߳ͳ
+	uint64_t retired_hits_[kNumClasses + 1] = { 0 };
+	uint64_t retired_fallbacks_[kNumClasses + 1] = { 0 };
 };
 
 }
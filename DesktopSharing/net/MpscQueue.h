@@ -0,0 +1,147 @@
+#ifndef XOP_MPSC_QUEUE_H
+#define XOP_MPSC_QUEUE_H
+
+/*
+MpscQueue н硢Ķߵ߶УDmitry Vyukov  bounded queue 㷨
+
+ÿλһţͨ CAS ռдλãд󷢲ţֻһλ CAS
+λڹʱһԷ䣬T ڲλо͵ظã/Ӷûжѷ䡣
+ȡΪ 2 ݡ
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace xop
+{
+
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		mask_ = size - 1;
+		buffer_.reset(new Cell[size]);
+		for (size_t n = 0; n < size; n++) {
+			buffer_[n].sequence.store(n, std::memory_order_relaxed);
+		}
+		enqueue_pos_.store(0, std::memory_order_relaxed);
+		dequeue_pos_.store(0, std::memory_order_relaxed);
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// ߳̿ͬʱãʱ false
+	template <typename F>
+	bool Push(F&& data)
+	{
+		Cell* cell = nullptr;
+		size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+		for (;;) {
+			cell = &buffer_[pos & mask_];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0) {
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = std::forward<F>(data);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// ̵ֻ߳á
+	bool Pop(T& data)
+	{
+		size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+		Cell* cell = &buffer_[pos & mask_];
+		if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+			return false;
+		}
+
+		data = std::move(cell->data);
+		cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+		dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// ̵ֻ߳ãڲλϾ͵ش max_count Ԫأشĸ
+	// ԪرΪ T()ٹ黹ߡ
+	template <typename Func>
+	size_t Consume(Func&& func, size_t max_count)
+	{
+		size_t count = 0;
+		size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+		while (count < max_count) {
+			Cell* cell = &buffer_[pos & mask_];
+			if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+				break;
+			}
+
+			func(cell->data);
+			cell->data = T();
+			cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+			pos += 1;
+			count += 1;
+			dequeue_pos_.store(pos, std::memory_order_relaxed);
+		}
+
+		return count;
+	}
+
+	// ֵͳƺжǷлѹ
+	size_t Size() const
+	{
+		size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+		size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+		return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+	}
+
+	bool IsEmpty() const
+	{ return Size() == 0; }
+
+	size_t Capacity() const
+	{ return mask_ + 1; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	static const size_t kCacheLineSize = 64;
+
+	std::unique_ptr<Cell[]> buffer_;
+	size_t mask_ = 0;
+	char pad0_[kCacheLineSize];
+	std::atomic<size_t> enqueue_pos_;
+	char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> dequeue_pos_;
+	char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+}
+
+#endif
@@ -6,6 +6,9 @@
 #include <random>
 #include <string>
 #include <array>
+#if defined(__linux) || defined(__linux__) 
+#include <sys/eventfd.h>
+#endif
 
 using namespace xop;
 
@@ -52,7 +55,9 @@ bool Pipe::Create()
 	SocketUtil::SetNonBlock(pipe_fd_[0]);
 	SocketUtil::SetNonBlock(pipe_fd_[1]);
 #elif defined(__linux) || defined(__linux__) 
-	if (pipe2(pipe_fd_, O_NONBLOCK | O_CLOEXEC) < 0) {
+	// Linux  eventfd ܵһдںۼΪһһζȡա
+	pipe_fd_[0] = pipe_fd_[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pipe_fd_[0] < 0) {
 		return false;
 	}
 #endif
@@ -64,7 +69,8 @@ int Pipe::Write(void *buf, int len)
 #if defined(WIN32) || defined(_WIN32) 
     return ::send(pipe_fd_[1], (char *)buf, len, 0);
 #elif defined(__linux) || defined(__linux__) 
-    return ::write(pipe_fd_[1], buf, len);
+    uint64_t one = 1;
+    return ::write(pipe_fd_[1], &one, sizeof(one)) == sizeof(one) ? len : -1;
 #endif 
 }
 
@@ -73,7 +79,8 @@ int Pipe::Read(void *buf, int len)
 #if defined(WIN32) || defined(_WIN32) 
     return recv(pipe_fd_[0], (char *)buf, len, 0);
 #elif defined(__linux) || defined(__linux__) 
-    return ::read(pipe_fd_[0], buf, len);
+    uint64_t count = 0;
+    return ::read(pipe_fd_[0], &count, sizeof(count)) == sizeof(count) ? len : -1;
 #endif 
 }
 
@@ -84,7 +91,6 @@ void Pipe::Close()
 	closesocket(pipe_fd_[1]);
 #elif defined(__linux) || defined(__linux__) 
 	::close(pipe_fd_[0]);
-	::close(pipe_fd_[1]);
 #endif
 
 }
@@ -0,0 +1,75 @@
+#include "PlacementPolicy.h"
+
+using namespace xop;
+
+std::shared_ptr<PlacementPolicy> PlacementPolicy::Create(PlacementPolicyType type)
+{
+	switch (type)
+	{
+	case PLACEMENT_LEAST_CONNECTIONS:
+		return std::make_shared<LeastConnectionsPolicy>();
+	case PLACEMENT_LEAST_BYTES:
+		return std::make_shared<LeastBytesPolicy>();
+	case PLACEMENT_LEAST_UTILIZATION:
+		return std::make_shared<LeastUtilizationPolicy>();
+	default:
+		break;
+	}
+	return std::make_shared<RoundRobinPolicy>();
+}
+
+/*
+ next_ ʼαȽϣϸС滻ͬʱֵÿ
+*/
+size_t PlacementPolicy::SelectMin(const std::vector<LoadStats>& loads, uint64_t (*primary)(const LoadStats&))
+{
+	size_t count = loads.size();
+	size_t best = next_ % count;
+	uint64_t best_primary = primary(loads[best]);
+	uint32_t best_connections = loads[best].connections;
+
+	for (size_t n = 1; n < count; n++) {
+		size_t index = (next_ + n) % count;
+		uint64_t value = primary(loads[index]);
+		if (value < best_primary || (value == best_primary && loads[index].connections < best_connections)) {
+			best = index;
+			best_primary = value;
+			best_connections = loads[index].connections;
+		}
+	}
+
+	next_ = best + 1;
+	return best;
+}
+
+size_t RoundRobinPolicy::Select(const std::vector<LoadStats>& loads)
+{
+	size_t index = next_ % loads.size();
+	next_ = index + 1;
+	return index;
+}
+
+size_t LeastConnectionsPolicy::Select(const std::vector<LoadStats>& loads)
+{
+	return SelectMin(loads, [](const LoadStats& load) -> uint64_t {
+		return load.connections;
+	});
+}
+
+/*
+ʰ 16KB/sʰ 1% ȡȽϣСʱ
+֮ͳذڶ
+*/
+size_t LeastBytesPolicy::Select(const std::vector<LoadStats>& loads)
+{
+	return SelectMin(loads, [](const LoadStats& load) -> uint64_t {
+		return load.send_rate >> 14;
+	});
+}
+
+size_t LeastUtilizationPolicy::Select(const std::vector<LoadStats>& loads)
+{
+	return SelectMin(loads, [](const LoadStats& load) -> uint64_t {
+		return load.utilization / 10;
+	});
+}
@@ -0,0 +1,74 @@
+#ifndef XOP_PLACEMENT_POLICY_H
+#define XOP_PLACEMENT_POLICY_H
+
+/*
+ӷòԣEventLoop::GetTaskScheduler() ΪӣԼ RTMP/RTSP ͻˣѡ
+
+ǺѡĸؿգTaskScheduler::GetLoadStats()ѡе±ꡣ
+߳ʱһ acceptȫֶʱʹ¼ںѡ֮С
+ͬʱϴѡλõһʼȽϣʱͬһϡ
+send_rate  utilization ͳƣٺͺͬһ
+ָͬһϣ籩ĳ LEAST_CONNECTIONS
+Select()  EventLoop ڵãʵֲҪԼ
+*/
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "TaskScheduler.h"
+
+namespace xop
+{
+
+enum PlacementPolicyType
+{
+	PLACEMENT_ROUND_ROBIN       = 0,	// ѯĬϣǰΪͬ
+	PLACEMENT_LEAST_CONNECTIONS = 1,	// 
+	PLACEMENT_LEAST_BYTES       = 2,	// ͣͬʱ
+	PLACEMENT_LEAST_UTILIZATION = 3,	// ¼ѭͣͬʱ
+};
+
+class PlacementPolicy
+{
+public:
+	virtual ~PlacementPolicy() {}
+
+	// loads һԪأֵС loads.size()
+	virtual size_t Select(const std::vector<LoadStats>& loads) = 0;
+
+	static std::shared_ptr<PlacementPolicy> Create(PlacementPolicyType type);
+
+protected:
+	// ѡ (primary, connections) Сһ next_ ʼȽϣͬȡȱȽϵ
+	size_t SelectMin(const std::vector<LoadStats>& loads, uint64_t (*primary)(const LoadStats&));
+
+	size_t next_ = 0;
+};
+
+class RoundRobinPolicy : public PlacementPolicy
+{
+public:
+	virtual size_t Select(const std::vector<LoadStats>& loads);
+};
+
+class LeastConnectionsPolicy : public PlacementPolicy
+{
+public:
+	virtual size_t Select(const std::vector<LoadStats>& loads);
+};
+
+class LeastBytesPolicy : public PlacementPolicy
+{
+public:
+	virtual size_t Select(const std::vector<LoadStats>& loads);
+};
+
+class LeastUtilizationPolicy : public PlacementPolicy
+{
+public:
+	virtual size_t Select(const std::vector<LoadStats>& loads);
+};
+
+}
+
+#endif
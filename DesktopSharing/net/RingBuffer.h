@@ -4,10 +4,19 @@
 #ifndef XOP_RING_BUFFER_H
 #define XOP_RING_BUFFER_H
 
-#include <vector>
-#include <memory>
+/*
+RingBuffer н硢޵ȴĵߵ߶С
+
+дλֻ޸ģλֻ޸ģ acquire/release Push/Pop Ҫ CAS
+˸ԻһݶԷλãֻп/ʱ¶ȡԷԭӱٻеشݡ
+дλ÷ֱڶĻϡλȡΪ 2 ݣɵԪظΪ capacity
+ʹ MpscQueueҪȴʱ BlockingQueue ʹá
+*/
+
 #include <atomic>
-#include <iostream>
+#include <cstddef>
+#include <memory>
+#include <utility>
 
 namespace xop
 {
@@ -17,80 +26,141 @@ class RingBuffer
 {
 public:
 	RingBuffer(int capacity=60)
-		: capacity_(capacity)
-		, num_datas_(0)
-		, buffer_(capacity)
-	{ }
-	
+		: capacity_(capacity > 0 ? (size_t)capacity : 1)
+	{
+		size_t size = 1;
+		while (size < capacity_) {
+			size <<= 1;
+		}
+
+		mask_ = size - 1;
+		buffer_.reset(new T[size]);
+		put_pos_.store(0, std::memory_order_relaxed);
+		get_pos_.store(0, std::memory_order_relaxed);
+	}
+
 	virtual ~RingBuffer() {	}
 
-	bool Push(const T& data) 
-	{ 
-		return pushData(std::forward<T>(data)); 
-	} 	
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	// ̵ֻ߳ãʱ false
+	bool Push(const T& data)
+	{
+		return PushData(data);
+	}
+
+	bool Push(T&& data)
+	{
+		return PushData(std::move(data));
+	}
 
-	bool Push(T&& data) 
-	{ 
-		return PushData(data); 
-	} 
-        
+	// ̵ֻ߳ãпʱ false
 	bool Pop(T& data)
 	{
-		if(num_datas_ > 0) {
-			data = std::move(buffer_[get_pos_]);
-			Add(get_pos_);
-			num_datas_--;
-			return true;
+		T* slot = Front();
+		if (slot == nullptr) {
+			return false;
+		}
+
+		data = std::move(*slot);
+		CommitPop();
+		return true;
+	}
+
+	// ͵д루̵ֻ߳ãһвλʱ nullptrд CommitPush() 
+	T* BeginPush()
+	{
+		size_t pos = put_pos_.load(std::memory_order_relaxed);
+		if (pos - cached_get_pos_ >= capacity_) {
+			cached_get_pos_ = get_pos_.load(std::memory_order_acquire);
+			if (pos - cached_get_pos_ >= capacity_) {
+				return nullptr;
+			}
+		}
+
+		return &buffer_[pos & mask_];
+	}
+
+	void CommitPush()
+	{
+		put_pos_.store(put_pos_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// ͵ضȡ̵ֻ߳ãضԪأпʱ nullptr CommitPop() ͷŲλ
+	T* Front()
+	{
+		size_t pos = get_pos_.load(std::memory_order_relaxed);
+		if (pos == cached_put_pos_) {
+			cached_put_pos_ = put_pos_.load(std::memory_order_acquire);
+			if (pos == cached_put_pos_) {
+				return nullptr;
+			}
 		}
 
-		return false;
-	}	
+		return &buffer_[pos & mask_];
+	}
+
+	void CommitPop()
+	{
+		get_pos_.store(get_pos_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// ΪֵͳƺжǷлѹ
+	bool IsFull()  const
+	{
+		return Size() >= capacity_;
+	}
 
-	bool IsFull()  const 
-	{ 
-		return ((num_datas_==capacity_) ? true : false); 
-	}	
+	bool IsEmpty() const
+	{
+		return Size() == 0;
+	}
 
-	bool IsEmpty() const 
-	{ 
-		return ((num_datas_==0) ? true : false); 
+	size_t Size() const
+	{
+		size_t get_pos = get_pos_.load(std::memory_order_acquire);
+		size_t put_pos = put_pos_.load(std::memory_order_acquire);
+		return put_pos > get_pos ? put_pos - get_pos : 0;
 	}
 
-	int  Size() const 
-	{ 
-		return num_datas_; 
+	size_t Capacity() const
+	{
+		return capacity_;
 	}
-	
-private:		
+
+private:
 	template <typename F>
 	bool PushData(F&& data)
 	{
-		if (num_datas_ < capacity_)
-		{
-			buffer_[put_pos_] = std::forward<F>(data);
-			Add(put_pos_);
-			num_datas_++;
-			return true;
+		T* slot = BeginPush();
+		if (slot == nullptr) {
+			return false;
 		}
 
-		return false;
+		*slot = std::forward<F>(data);
+		CommitPush();
+		return true;
 	}
 
-	void Add(int& pos)
-	{	
-		pos = (((pos+1)==capacity_) ? 0 : (pos+1));
-	}
+	static const size_t kCacheLineSize = 64;
+
+	size_t capacity_ = 0;
+	size_t mask_ = 0;
+	std::unique_ptr<T[]> buffer_;
+	char pad0_[kCacheLineSize];
 
-	int capacity_ = 0;
-	int put_pos_ = 0;
-	int get_pos_ = 0;
+	// 
+	std::atomic<size_t> put_pos_;
+	size_t cached_get_pos_ = 0;
+	char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
 
-	std::atomic_int num_datas_;     			
-	std::vector<T> buffer_;
+	// 
+	std::atomic<size_t> get_pos_;
+	size_t cached_put_pos_ = 0;
+	char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
 };
 
 }
 
 #endif
-
-
@@ -17,7 +17,8 @@ using namespace xop;
 初始化fd_set备份集合。
 注册基类的wakeup_channel_（用于跨线程唤醒事件循环）。
 */
-SelectTaskScheduler::SelectTaskScheduler(int id) : TaskScheduler(id) 
+SelectTaskScheduler::SelectTaskScheduler(int id, TimerQueueType timer_queue_type, uint32_t timer_tick_us)
+	: TaskScheduler(id, timer_queue_type, timer_tick_us)
 {
 	FD_ZERO(&fd_read_backup_); // 清空fd_set
 	FD_ZERO(&fd_write_backup_);
@@ -181,6 +182,7 @@ bool SelectTaskScheduler::HandleEvent(int timeout)
 
 	struct timeval tv = { timeout/1000, timeout%1000*1000 };
 	int ret = select((int)maxfd_+1, &fd_read, &fd_write, &fd_exp, &tv); 	
+	this->RecordWakeup(ret > 0 ? (uint32_t)ret : 0);
 	if (ret < 0) {
 #if defined(__linux) || defined(__linux__) 
 	if(errno == EINTR) {
@@ -35,7 +35,7 @@ namespace xop
 class SelectTaskScheduler : public TaskScheduler
 {
 public:
-	SelectTaskScheduler(int id = 0);
+	SelectTaskScheduler(int id = 0, TimerQueueType timer_queue_type = TIMER_QUEUE_MAP, uint32_t timer_tick_us = 1000);
 	virtual ~SelectTaskScheduler();
 
 	void UpdateChannel(ChannelPtr channel);
@@ -4,6 +4,9 @@
 #include "SocketUtil.h"
 #include "Socket.h"
 #include <iostream>
+#if defined(__linux) || defined(__linux__) 
+#include <linux/filter.h>
+#endif
 
 using namespace xop;
 
@@ -71,6 +74,28 @@ void SocketUtil::SetReusePort(SOCKET sockfd)
 #endif	
 }
 
+bool SocketUtil::SetReusePortCpuSteering(SOCKET sockfd, uint32_t num_sockets)
+{
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU)
+    // return cpu % num_sockets: pick the listener in the SO_REUSEPORT group by the CPU handling the SYN
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, num_sockets },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    if (num_sockets == 0) {
+        return false;
+    }
+    return setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+#else
+    return false;
+#endif
+}
+
 void SocketUtil::SetNoDelay(SOCKET sockfd)
 {
 #ifdef TCP_NODELAY
@@ -103,6 +128,29 @@ void SocketUtil::SetRecvBufSize(SOCKET sockfd, int size)
     setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, (char *)&size, sizeof(size));
 }
 
+bool SocketUtil::SetZeroCopy(SOCKET sockfd)
+{
+#if defined(__linux) || defined(__linux__)
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+    int on = 1;
+    return setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, (char *)&on, sizeof(on)) == 0;
+#else
+    return false;
+#endif
+}
+
+int SocketUtil::GetSocketError(SOCKET sockfd)
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, (char *)&error, &len) != 0) {
+        return -1;
+    }
+    return error;
+}
+
 std::string SocketUtil::GetPeerIp(SOCKET sockfd)
 {
     struct sockaddr_in addr = { 0 };
@@ -191,3 +239,11 @@ bool SocketUtil::Connect(SOCKET sockfd, std::string ip, uint16_t port, int timeo
 	return is_connected;
 }
 
+bool SocketUtil::IsWouldBlock()
+{
+#if defined(__linux) || defined(__linux__) 
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#elif defined(WIN32) || defined(_WIN32)
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
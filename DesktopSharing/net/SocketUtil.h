@@ -18,17 +18,21 @@ public:
     static void SetBlock(SOCKET fd, int write_timeout=0);
     static void SetReuseAddr(SOCKET fd);
     static void SetReusePort(SOCKET sockfd);
+    static bool SetReusePortCpuSteering(SOCKET sockfd, uint32_t num_sockets);
     static void SetNoDelay(SOCKET sockfd);
     static void SetKeepAlive(SOCKET sockfd);
     static void SetNoSigpipe(SOCKET sockfd);
     static void SetSendBufSize(SOCKET sockfd, int size);
     static void SetRecvBufSize(SOCKET sockfd, int size);
+    static bool SetZeroCopy(SOCKET sockfd);	//  SO_ZEROCOPYLinux 4.14+֧ʱ false
+    static int GetSocketError(SOCKET sockfd);	// ȡ SO_ERROR
     static std::string GetPeerIp(SOCKET sockfd);
     static std::string GetSocketIp(SOCKET sockfd);
     static int GetSocketAddr(SOCKET sockfd, struct sockaddr_in* addr);
     static uint16_t GetPeerPort(SOCKET sockfd);
     static int GetPeerAddr(SOCKET sockfd, struct sockaddr_in *addr);
     static void Close(SOCKET sockfd);
+    static bool IsWouldBlock();	// һη socket Ƿ EAGAIN/EWOULDBLOCK ʧ
     static bool Connect(SOCKET sockfd, std::string ip, uint16_t port, int timeout=0);
 };
 
@@ -5,17 +5,46 @@
 
 using namespace xop;
 
+static int64_t GetMicroseconds()
+{
+	auto time_point = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(time_point.time_since_epoch()).count();
+}
+
 /*
 ƽ̨ʼWindows³ʼWinsock
-̼ܵ߳份ѡ
+̼ܵ߳份ѣLinuxΪeventfd
 ûChannelܵˣʱWake()չܵ
+ʱУTIMER_QUEUE_WHEEL ʹ÷ֲʱ֣timer_tick_us Ϊ tick ȣ΢룩
 */
-TaskScheduler::TaskScheduler(int id)
+TaskScheduler::TaskScheduler(int id, TimerQueueType timer_queue_type, uint32_t timer_tick_us)
 	: id_(id)
+	, loop_thread_id_(std::thread::id())
 	, is_shutdown_(false) 
 	, wakeup_pipe_(new Pipe())
-	, trigger_events_(new xop::RingBuffer<TriggerEvent>(kMaxTriggetEvents))
+	, trigger_events_(new xop::MpscQueue<TriggerEvent>(kMaxTriggetEvents))
+	, wakeup_pending_(false)
+	, io_wakeups_(0)
+	, io_events_(0)
+	, io_read_events_(0)
+	, io_extra_reads_(0)
+	, io_accept_events_(0)
+	, io_extra_accepts_(0)
+	, io_tasks_(0)
+	, load_connections_(0)
+	, load_bytes_sent_(0)
+	, load_send_rate_(0)
+	, load_utilization_(0)
+	, load_updated_(0)
+	, is_polling_(false)
 {
+	if (timer_queue_type == TIMER_QUEUE_WHEEL) {
+		timer_queue_.reset(new TimerWheel(timer_tick_us));
+	}
+	else {
+		timer_queue_.reset(new TimerQueue());
+	}
+
 	// WindowsʼһΣ
 	static std::once_flag flag;
 	std::call_once(flag, [] {
@@ -60,11 +89,22 @@ void TaskScheduler::Start()
 	signal(SIGKILL, SIG_IGN);
 #endif     
 	is_shutdown_ = false;
+	loop_thread_id_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	window_begin_ = GetMicroseconds();
+	window_idle_ = 0;
+	window_bytes_ = load_bytes_sent_.load(std::memory_order_relaxed);
+	load_updated_.store(window_begin_, std::memory_order_relaxed);
 	while (!is_shutdown_) {
-		this->HandleTriggerEvent();					// 첽
-		this->timer_queue_.HandleTimerEvent();		// ʱ
-		int64_t timeout = this->timer_queue_.GetTimeRemaining();
+		bool has_pending = this->HandleTriggerEvent();	// 첽
+		this->timer_queue_->HandleTimerEvent();		// ʱ
+		int64_t timeout = this->timer_queue_->GetTimeRemaining();
+		if (has_pending) {
+			timeout = 0;							// лѹֻѯI/O
+		}
+		int64_t poll_begin = GetMicroseconds();
+		is_polling_.store(true, std::memory_order_relaxed);
 		this->HandleEvent((int)timeout);			// ʵ֣epoll_wait
+		this->RecordLoop(poll_begin);
 	}
 }
 
@@ -77,59 +117,202 @@ void TaskScheduler::Stop()
 
 /*
 ʱ
-ίиtimer_queue_ʵTimerQueueദ֧Ӻɾʱ
+ίиtimer_queue_ʵTimerQueueTimerWheelദ֧Ӻɾʱ
+¼ѭ֮ǰʱ HandleEvent У߳ӵĶʱܸ絽ڣ
+˻¼ѭ¼㳬ʱͶݹûѺϲ¼ѭ߳ʱһȻ¼㡣
 */
 TimerId TaskScheduler::AddTimer(TimerEvent timerEvent, uint32_t msec)
 {
-	TimerId id = timer_queue_.AddTimer(timerEvent, msec);
+	TimerId id = timer_queue_->AddTimer(timerEvent, msec);
+	if (id != 0 && !this->IsInLoopThread()) {
+		this->WakeLoop();
+	}
 	return id;
 }
 
 /*
 ʱ
-ίиtimer_queue_ʵTimerQueueദ֧Ӻɾʱ
+ίиtimer_queue_ʵTimerQueueTimerWheelദ֧Ӻɾʱ
 */
 void TaskScheduler::RemoveTimer(TimerId timerId)
 {
-	timer_queue_.RemoveTimer(timerId);
+	timer_queue_->RemoveTimer(timerId);
 }
 
 /*
-ص뻷λ
-ܵдݣѿHandleEvent()е¼ѭ
+ص͵ع쵽еĲλУСбڴ棩
+Ѻϲֻ wakeup_pending_  false Ϊ true һͶݲд¼
+¼ѭ֮ǰͶݲٲϵͳá
 */
 bool TaskScheduler::AddTriggerEvent(TriggerEvent callback)
 {
-	if (trigger_events_->Size() < kMaxTriggetEvents) {
-		std::lock_guard<std::mutex> lock(mutex_);
-		char event = kTriggetEvent;
-		trigger_events_->Push(std::move(callback));
-		wakeup_pipe_->Write(&event, 1);
+	if (!trigger_events_->Push(std::move(callback))) {
+		return false;
+	}
+
+	this->WakeLoop();
+	return true;
+}
+
+bool TaskScheduler::RunInLoop(TriggerEvent callback)
+{
+	if (this->IsInLoopThread()) {
+		callback();
 		return true;
 	}
+	return this->AddTriggerEvent(std::move(callback));
+}
+
+bool TaskScheduler::IsInLoopThread() const
+{
+	return loop_thread_id_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
 
-	return false;
+void TaskScheduler::WakeLoop()
+{
+	if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+		char event = kTriggetEvent;
+		wakeup_pipe_->Write(&event, 1);
+	}
 }
 
 /*
 ãܵݿɶʱѣȡݣظ
+ȶչܵϲ־ȡ֮дĻ¼ᱻһ
+־ѱλ֮Ͷݶд룬ֻܵ I/O ʱѡ
+־֮ǰ־λδдͶݣڶУɽ HandleTriggerEvent() 
 */
 void TaskScheduler::Wake()
 {
 	char event[10] = { 0 };
 	while (wakeup_pipe_->Read(event, 10) > 0);
+
+	wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+}
+
+/*
+ѻصڶвλϾ͵ִÿ kMaxTriggerBatch 
+ true ʾлѹ
+*/
+bool TaskScheduler::HandleTriggerEvent()
+{
+	size_t count = trigger_events_->Consume([](TriggerEvent& callback) {
+		callback();
+	}, kMaxTriggerBatch);
+	if (count > 0) {
+		io_tasks_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	return !trigger_events_->IsEmpty();
+}
+
+/*
+I/O ͳƣֻ¼ѭ߳ۼӣʹ relaxed ԭӲȡõǽƿա
+*/
+void TaskScheduler::RecordWakeup(uint32_t events)
+{
+	poll_end_ = GetMicroseconds();
+	is_polling_.store(false, std::memory_order_relaxed);
+
+	if (events > 0) {
+		io_wakeups_.fetch_add(1, std::memory_order_relaxed);
+		io_events_.fetch_add(events, std::memory_order_relaxed);
+	}
+}
+
+void TaskScheduler::RecordRead(uint32_t reads)
+{
+	io_read_events_.fetch_add(1, std::memory_order_relaxed);
+	if (reads > 1) {
+		io_extra_reads_.fetch_add(reads - 1, std::memory_order_relaxed);
+	}
+}
+
+void TaskScheduler::RecordAccept(uint32_t accepts)
+{
+	io_accept_events_.fetch_add(1, std::memory_order_relaxed);
+	if (accepts > 1) {
+		io_extra_accepts_.fetch_add(accepts - 1, std::memory_order_relaxed);
+	}
+}
+
+IoStats TaskScheduler::GetIoStats() const
+{
+	IoStats stats;
+	stats.wakeups = io_wakeups_.load(std::memory_order_relaxed);
+	stats.events = io_events_.load(std::memory_order_relaxed);
+	stats.read_events = io_read_events_.load(std::memory_order_relaxed);
+	stats.extra_reads = io_extra_reads_.load(std::memory_order_relaxed);
+	stats.accept_events = io_accept_events_.load(std::memory_order_relaxed);
+	stats.extra_accepts = io_extra_accepts_.load(std::memory_order_relaxed);
+	stats.tasks = io_tasks_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void TaskScheduler::AddConnection(int delta)
+{
+	load_connections_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void TaskScheduler::RecordSend(uint32_t bytes)
+{
+	load_bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
 }
 
 /*
-ѻصӻλȡִС
+ÿ¼ѭһΣȴ I/O ʱ䣨 HandleEvent  RecordWakeupΪУΪæµ
+ûе RecordWakeupأʱ HandleEvent ΪС
+ kLoadWindowUs 󷢲ʺͷʣʼ´ڡ
 */
-void TaskScheduler::HandleTriggerEvent()
+void TaskScheduler::RecordLoop(int64_t poll_begin)
 {
-	do 
-	{
-		TriggerEvent callback;
-		if (trigger_events_->Pop(callback)) {
-			callback();
+	int64_t now = GetMicroseconds();
+	int64_t poll_end = poll_end_ >= poll_begin ? poll_end_ : now;
+	is_polling_.store(false, std::memory_order_relaxed);
+	window_idle_ += poll_end - poll_begin;
+
+	int64_t elapsed = now - window_begin_;
+	if (elapsed < kLoadWindowUs) {
+		return;
+	}
+
+	int64_t busy = elapsed - window_idle_;
+	if (busy < 0) {
+		busy = 0;
+	}
+	uint64_t bytes_sent = load_bytes_sent_.load(std::memory_order_relaxed);
+	load_utilization_.store((uint32_t)(busy * 1000 / elapsed), std::memory_order_relaxed);
+	load_send_rate_.store((bytes_sent - window_bytes_) * 1000000 / (uint64_t)elapsed, std::memory_order_relaxed);
+	load_updated_.store(now, std::memory_order_relaxed);
+
+	window_begin_ = now;
+	window_idle_ = 0;
+	window_bytes_ = bytes_sent;
+}
+
+/*
+ֻ¼ѭתʱ£ûиʱ
+ڵȴ I/O ˵һֱУʺʰʱ˥ڻصʰɼơ
+*/
+LoadStats TaskScheduler::GetLoadStats() const
+{
+	LoadStats stats;
+	int32_t connections = load_connections_.load(std::memory_order_relaxed);
+	stats.connections = connections > 0 ? (uint32_t)connections : 0;
+	stats.bytes_sent = load_bytes_sent_.load(std::memory_order_relaxed);
+	stats.send_rate = load_send_rate_.load(std::memory_order_relaxed);
+	stats.utilization = load_utilization_.load(std::memory_order_relaxed);
+
+	int64_t updated = load_updated_.load(std::memory_order_relaxed);
+	int64_t stale = GetMicroseconds() - updated;
+	if (updated > 0 && stale > 2 * kLoadWindowUs) {
+		if (is_polling_.load(std::memory_order_relaxed)) {
+			stats.send_rate = stats.send_rate * kLoadWindowUs / stale;
+			stats.utilization = (uint32_t)(stats.utilization * kLoadWindowUs / stale);
 		}
-	} while (trigger_events_->Size() > 0);
+		else {
+			stats.utilization = 1000;
+		}
+	}
+	return stats;
 }
@@ -8,7 +8,7 @@
 TaskSchedulerXOPȺģṩ
 
 ͳһ¼ѭܣI/O¼ʱ첽
-߳ȣͨܵͻλʵ̼߳ͨš
+߳ȣͨ¼LinuxΪeventfdʵ̼߳ͨš
 չԣͨʵHandleEvent()ֲ֧ͬI/O·ûƣepollkqueue
 ˸ĵ¼첽صԴЧʵʹעԴͷź̰߳ȫ⡣
 */
@@ -16,31 +16,70 @@ TaskScheduler
 #include "Channel.h"
 #include "Pipe.h"
 #include "Timer.h"
-#include "RingBuffer.h"
+#include "TimerWheel.h"
+#include "TriggerEvent.h"
+#include "MpscQueue.h"
 
 namespace xop
 {
 
-typedef std::function<void(void)> TriggerEvent;
+/*
+I/O ֪ͨͳƣGetIoStats() صĿգ
+һζ/accept ֪ͨڣһ֮ÿһγɹ recv/accept ʡһ¼ѭ
+شģʽ¶ EAGAIN Ϊֹaccept Ǵѹӣ
+*/
+struct IoStats
+{
+	uint64_t wakeups = 0;			// HandleEvent ˾¼Ĵ
+	uint64_t events = 0;			// ַ Channel ľ¼
+	uint64_t read_events = 0;		// TcpConnection Ķ֪ͨ
+	uint64_t extra_reads = 0;		// ͬһ֪ͨڶɹ recv 
+	uint64_t accept_events = 0;		//  socket ľ֪ͨ
+	uint64_t extra_accepts = 0;		// ͬһ֪ͨڶ accept 
+	uint64_t tasks = 0;				// ִеĴ¼AddTriggerEvent Ͷݵ
+
+	uint64_t WakeupsSaved() const
+	{ return extra_reads + extra_accepts; }
+};
+
+/*
+أGetLoadStats() صĿգ EventLoop ӷòʹá
+send_rate  utilization Լ 500ms Ĵͳƣ¼ѭʱڵȴ I/O ʱ˥
+ʱ俨ڻصʱ utilization ɼơ
+*/
+struct LoadStats
+{
+	uint32_t connections = 0;		// ǰǼڸõϵ TcpConnection 
+	uint64_t bytes_sent = 0;		// ۼƷֽ
+	uint64_t send_rate = 0;			// ڵķʣֽ/룩
+	uint32_t utilization = 0;		// ¼ѭڵȴ I/O ʱռȣǧֱȣ0~1000
+};
 
 /*
 ְΪȵĻ࣬ṩƽ̨¼ѭܣʱ̼߳份Ѻ첽񴥷
 ģʽReactorģʽ¼Proactorģʽ첽񣩣֧֣
 I/O¼ʵ֣EpollTaskScheduler
 ʱȡ
-߳񴥷ͨܵѺͻλ
+߳񴥷ͨϲĻ¼УִУ
 */
 class TaskScheduler 
 {
 public:
-	TaskScheduler(int id=1);
+	TaskScheduler(int id=1, TimerQueueType timer_queue_type=TIMER_QUEUE_MAP, uint32_t timer_tick_us=1000);
 	virtual ~TaskScheduler();
 
 	void Start();
 	void Stop();
+
+	// ʱڱ¼ѭִ߳УӦʹԼĽӿڡ
+	// ߳Ӷʱʱỽ¼ѭµʱµȴ
 	TimerId AddTimer(TimerEvent timerEvent, uint32_t msec);
 	void RemoveTimer(TimerId timerId);
 	bool AddTriggerEvent(TriggerEvent callback);
+	// ¼ѭֱִ߳УͶΪ¼Ͷʧܣ false
+	bool RunInLoop(TriggerEvent callback);
+	// ǰ߳ǷΪ¼ѭ̣߳Start() ֮ǰ false
+	bool IsInLoopThread() const;
 
 	virtual void UpdateChannel(ChannelPtr channel) { };
 	virtual void RemoveChannel(ChannelPtr& channel) { };
@@ -49,28 +88,74 @@ public:
 	int GetId() const 
 	{ return id_; }
 
+	// شEPOLLETʱChannel Ļص/д/accept  EAGAIN Ϊֹ
+	bool IsEdgeTriggered() const
+	{ return edge_triggered_; }
+
+	// һζ/accept ֪ͨڳɹ recv/accept  TcpConnection/Acceptor ¼ѭ߳ڵá
+	void RecordRead(uint32_t reads);
+	void RecordAccept(uint32_t accepts);
+	IoStats GetIoStats() const;
+
+	// 뷢ֽ TcpConnection ãͿ̣߳
+	void AddConnection(int delta);
+	void RecordSend(uint32_t bytes);
+	LoadStats GetLoadStats() const;
+
 protected:
 	void Wake();
-	void HandleTriggerEvent();
+	//  HandleEvent е¼ѭͶݹûѺϲ
+	void WakeLoop();
+	bool HandleTriggerEvent();
+	// ڵȴ I/O ϵͳ÷غãʹûо¼ͬʱǵȴʱ䡣
+	void RecordWakeup(uint32_t events);
+	// ÿ¼ѭʱãpoll_begin Ϊ HandleEvent ʱ䣬ۼƴڲ¸ء
+	void RecordLoop(int64_t poll_begin);
+
+	// ǷԱشʽע ChannelĿǰֻ EpollTaskScheduler ֧֣
+	bool edge_triggered_ = false;
 
 	// Ψһʶڶ߳ÿ߳һ
 	int id_ = 0;
+	// ¼ѭ̣߳Start()  HandleEvent() м¼
+	std::atomic<std::thread::id> loop_thread_id_;
 	// ԭӱ־λ¼ѭͣ
 	std::atomic_bool is_shutdown_;
 	// ܵƽ̨װ̼߳份¼ѭ
 	std::unique_ptr<Pipe> wakeup_pipe_;
 	// wakeup_pipe_˵Channel¼
 	std::shared_ptr<Channel> wakeup_channel_;
-	// λ洢첽ص̰߳ȫ
-	std::unique_ptr<xop::RingBuffer<TriggerEvent>> trigger_events_;
-	// trigger_events_̰߳ȫ
-	std::mutex mutex_;
-	// ʱУʱӡɾִС
-	TimerQueue timer_queue_;
+	// ߵ߶У洢첽صλԤ䡣
+	std::unique_ptr<xop::MpscQueue<TriggerEvent>> trigger_events_;
+	// Ѻϲ־д뻽¼¼ѭδʱΪ trueڼͶݵظд롣
+	std::atomic_bool wakeup_pending_;
+	// ʱУʱӡɾִУstd::map ʵֲֻʱ֣ʱѡ񣩡
+	std::unique_ptr<TimerQueueBase> timer_queue_;
+	// I/O ֻ֪ͨ¼ѭ߳ۼӣ߳ͨ GetIoStats() ȡ
+	std::atomic<uint64_t> io_wakeups_;
+	std::atomic<uint64_t> io_events_;
+	std::atomic<uint64_t> io_read_events_;
+	std::atomic<uint64_t> io_extra_reads_;
+	std::atomic<uint64_t> io_accept_events_;
+	std::atomic<uint64_t> io_extra_accepts_;
+	std::atomic<uint64_t> io_tasks_;
+	// ͳƣ̸߳£״ֻ̬¼ѭ߳ڷʡ
+	std::atomic<int32_t> load_connections_;
+	std::atomic<uint64_t> load_bytes_sent_;
+	std::atomic<uint64_t> load_send_rate_;
+	std::atomic<uint32_t> load_utilization_;
+	std::atomic<int64_t> load_updated_;		// һθ´ڵʱ䣨΢룩
+	std::atomic<bool> is_polling_;			// ¼ѭڵȴ I/O 
+	int64_t poll_end_ = 0;					// ֵȴ I/O صʱ䣨΢룩
+	int64_t window_begin_ = 0;				// ǰڵĿʼʱ䣨΢룩
+	int64_t window_idle_ = 0;				// ǰڵȴ I/O ʱ䣨΢룩
+	uint64_t window_bytes_ = 0;				// ǰڿʼʱۼƷֽ
 
 	static const char kTriggetEvent = 1;			// ¼ıʶַ
 	static const char kTimerEvent = 2;				// ʱ¼ıʶδֱʹã
-	static const int  kMaxTriggetEvents = 50000;	// λֹڴ
+	static const int  kMaxTriggetEvents = 50000;	// еȡΪ2ݣֹڴ
+	static const int  kMaxTriggerBatch = 1024;		// ÿ¼ѭִеI/OͶʱ
+	static const int64_t kLoadWindowUs = 500000;	// ͳƴڣ΢룩
 };
 
 }
@@ -11,11 +11,11 @@ using namespace xop;
 */
 //  socket һϵв
 TcpConnection::TcpConnection(TaskScheduler* task_scheduler, SOCKET sockfd)
-	: task_scheduler_(task_scheduler), channel_(new Channel(sockfd))
+	: task_scheduler_(task_scheduler), is_closed_(false), is_draining_(false), channel_(new Channel(sockfd))
 {
 	// ʼ
 	read_buffer_.reset(new BufferReader);
-	write_buffer_.reset(new BufferWriter(500)); // ʼ 500 ֽ
+	write_buffer_.reset(new BufferWriter(1000)); //  1000 ƬΣRTP over TCP ÿռͷ͸ 2 ƬΣ
 
 	// ÷TCP
 	SocketUtil::SetNonBlock(sockfd);
@@ -31,10 +31,15 @@ TcpConnection::TcpConnection(TaskScheduler* task_scheduler, SOCKET sockfd)
 	// ע¼ EventLoop
 	channel_->EnableReading();
 	task_scheduler_->UpdateChannel(channel_);
+	task_scheduler_->AddConnection(1);	// أClose() ʱȥ
 }
 
 TcpConnection::~TcpConnection()
 {
+	if (!is_closed_) {
+		task_scheduler_->AddConnection(-1);
+	}
+
 	SOCKET fd = channel_->GetSocket();
 	if (fd > 0) {
 		SocketUtil::Close(fd);
@@ -43,7 +48,7 @@ TcpConnection::~TcpConnection()
 
 void TcpConnection::Send(std::shared_ptr<char> data, uint32_t size)
 {
-	if (!is_closed_) {
+	if (!is_closed_ && !is_draining_) {
 		mutex_.lock();
 		write_buffer_->Append(data, size);
 		mutex_.unlock();
@@ -58,7 +63,7 @@ void TcpConnection::Send(std::shared_ptr<char> data, uint32_t size)
 */
 void TcpConnection::Send(const char *data, uint32_t size)
 {
-	if (!is_closed_) {
+	if (!is_closed_ && !is_draining_) {
 		mutex_.lock();
 		write_buffer_->Append(data, size); // ׷ӵд
 		mutex_.unlock();
@@ -67,6 +72,74 @@ void TcpConnection::Send(const char *data, uint32_t size)
 	}
 }
 
+/*
+RTP over TCPHTTP-FLV ȡСͷ + ءķͣͷдڴ飬ذ׷ӡ
+*/
+bool TcpConnection::Send(const char* header, uint32_t header_size, std::shared_ptr<char> payload, uint32_t payload_size,
+                         const char* trailer, uint32_t trailer_size)
+{
+	if (is_closed_ || is_draining_) {
+		return false;
+	}
+
+	// ÿռһƬΣȰ飬֤Ҫôȫ׷ӣҪô׷
+	uint32_t count = (header_size > 0) + (payload_size > 0) + (trailer_size > 0);
+
+	mutex_.lock();
+	bool queued = write_buffer_->HasRoom(count);
+	if (queued) {
+		if (header_size > 0) {
+			write_buffer_->Append(header, header_size);
+		}
+		if (payload_size > 0) {
+			write_buffer_->Append(payload, payload_size);
+		}
+		if (trailer_size > 0) {
+			write_buffer_->Append(trailer, trailer_size);
+		}
+	}
+	mutex_.unlock();
+
+	this->HandleWrite();
+	return queued;
+}
+
+size_t TcpConnection::Send(const SendSlice* slices, size_t count)
+{
+	if (is_closed_ || is_draining_) {
+		return 0;
+	}
+
+	size_t n = 0;
+	mutex_.lock();
+	for (; n < count; n++) {
+		if (!write_buffer_->HasRoom((slices[n].header_size > 0) + (slices[n].payload_size > 0))) {
+			break;
+		}
+		if (slices[n].header_size > 0) {
+			write_buffer_->Append(slices[n].header, slices[n].header_size);
+		}
+		if (slices[n].payload_size > 0) {
+			write_buffer_->Append(slices[n].payload, slices[n].payload_size);
+		}
+	}
+	mutex_.unlock();
+
+	this->HandleWrite();
+	return n;
+}
+
+bool TcpConnection::SetZeroCopy(uint32_t threshold)
+{
+	if (threshold > 0 && !SocketUtil::SetZeroCopy(channel_->GetSocket())) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	write_buffer_->SetZeroCopyThreshold(threshold);
+	return true;
+}
+
 void TcpConnection::Disconnect()
 {
 	std::lock_guard<std::mutex> lock(mutex_);
@@ -76,6 +149,33 @@ void TcpConnection::Disconnect()
 	});
 }
 
+/*
+ſչرգ is_draining_ ס֮ Send()ٵ߳д
+Ϊرգȷд¼ HandleWrite() ڷʱرա
+*/
+void TcpConnection::DisconnectAfterFlush()
+{
+	is_draining_ = true;
+	auto conn = shared_from_this();
+	task_scheduler_->AddTriggerEvent([conn]() {
+		std::lock_guard<std::mutex> lock(conn->mutex_);
+		if (conn->is_closed_) {
+			return;
+		}
+		if (conn->write_buffer_->IsEmpty()) {
+			conn->Close();
+		}
+		else if (!conn->channel_->IsWriting()) {
+			conn->channel_->EnableWriting();
+			conn->task_scheduler_->UpdateChannel(conn->channel_);
+		}
+	});
+}
+
+/*
+ˮƽÿ֪ͨһΡ
+ش EAGAIN Ϊֹٻص read_cb_ʣݲ֪ͨĴ I/O ͳơ
+*/
 void TcpConnection::HandleRead()
 {
 	{
@@ -85,10 +185,33 @@ void TcpConnection::HandleRead()
 			return;
 		}
 		
-		int ret = read_buffer_->Read(channel_->GetSocket());
-		if (ret <= 0) {
-			this->Close();
-			return;
+		if (!task_scheduler_->IsEdgeTriggered()) {
+			int ret = read_buffer_->Read(channel_->GetSocket());
+			if (ret <= 0) {
+				this->Close();
+				return;
+			}
+			task_scheduler_->RecordRead(1);
+		}
+		else {
+			uint32_t reads = 0;
+			while (true) {
+				int ret = read_buffer_->Read(channel_->GetSocket());
+				if (ret > 0) {
+					reads += 1;
+					continue;
+				}
+				if (ret < 0 && SocketUtil::IsWouldBlock()) {
+					break;
+				}
+				this->Close();	// Զ˹رա
+				return;
+			}
+
+			task_scheduler_->RecordRead(reads);
+			if (reads == 0) {
+				return;
+			}
 		}
 	}
 
@@ -112,10 +235,19 @@ void TcpConnection::HandleRead()
 void TcpConnection::HandleWrite() {
 	if (is_closed_) return;
 
-	if (!mutex_.try_lock()) return; // Լ
+	if (!mutex_.try_lock()) { // Լ
+		// شʱοд֪ͨظ¼ѭԺԣڻ
+		if (task_scheduler_->IsEdgeTriggered()) {
+			auto conn = shared_from_this();
+			task_scheduler_->AddTriggerEvent([conn]() { conn->HandleWrite(); });
+		}
+		return;
+	}
 
 	int ret = 0;
 	bool empty = false;
+	// شʱд EAGAINSend  0򻺳ΪΪֹһοдֻ֪ͨڻΪʱ
+	bool drain = task_scheduler_->IsEdgeTriggered();
 	do {
 		ret = write_buffer_->Send(channel_->GetSocket()); // 
 		if (ret < 0) { // ʧܣӶϿ
@@ -123,8 +255,18 @@ void TcpConnection::HandleWrite() {
 			mutex_.unlock();
 			return;
 		}
+		if (ret > 0) {
+			task_scheduler_->RecordSend((uint32_t)ret);
+		}
 		empty = write_buffer_->IsEmpty();
-	} while (0); // չΪѭͣģʽ¶ηͣ
+	} while (drain && ret > 0 && !empty);
+
+	// ſչرѷ
+	if (empty && is_draining_) {
+		Close();
+		mutex_.unlock();
+		return;
+	}
 
 	// ̬ע/עд¼
 	if (empty) {
@@ -150,6 +292,7 @@ void TcpConnection::Close()
 	if (!is_closed_) {
 		is_closed_ = true;
 		task_scheduler_->RemoveChannel(channel_); // ע¼
+		task_scheduler_->AddConnection(-1);
 
 		// ûصϲ
 		if (close_cb_) close_cb_(shared_from_this());
@@ -164,8 +307,17 @@ void TcpConnection::HandleClose()
 	this->Close();
 }
 
+/*
+㿽֪ͨͨУEPOLLERRʹ֪ͨ socket ûĴʱرӡ
+*/
 void TcpConnection::HandleError()
 {
 	std::lock_guard<std::mutex> lock(mutex_);
+	if (write_buffer_->IsZeroCopy() && !is_closed_) {
+		if (write_buffer_->ReadZeroCopyCompletions(channel_->GetSocket()) >= 0
+			&& SocketUtil::GetSocketError(channel_->GetSocket()) == 0) {
+			return;
+		}
+	}
 	this->Close();
 }
@@ -28,6 +28,15 @@ TcpConnection 
 namespace xop
 {
 
+// Send(slices, count) һƬΣͷдذ׷ӣΪգ
+struct SendSlice
+{
+	const char* header = nullptr;
+	uint32_t header_size = 0;
+	std::shared_ptr<char> payload;
+	uint32_t payload_size = 0;
+};
+
 class TcpConnection : public std::enable_shared_from_this<TcpConnection>
 {
 public:
@@ -50,8 +59,35 @@ public:
 
 	void Send(std::shared_ptr<char> data, uint32_t size);
 	void Send(const char *data, uint32_t size);
+	//  header/trailerpayload ֻã HandleWrite ϲΪһ sendmsg ͡
+	// Ϊһ׷ӣдŲʱ falseֻ׷ӽͷƻķ֡
+	bool Send(const char* header, uint32_t header_size, std::shared_ptr<char> payload, uint32_t payload_size,
+	          const char* trailer = nullptr, uint32_t trailer_size = 0);
+	// һμ׷ӶƬΣһ֡ RTP over TCP ֻ֮ԷһΡ
+	// ÿƬΣͷ + أ׷ӣŲµƬʱ֮Ƭζ׷ӵƬ
+	size_t Send(const SendSlice* slices, size_t count);
     
 	void Disconnect();
+	// ſչرգٽµķݣдеݷرӣִ߳У
+	// Զ˲ȡʱһֱ꣬ɵ÷ TcpServer::Drainڳʱ Disconnect()
+	void DisconnectAfterFlush();
+
+	// дд͵ֽ
+	uint64_t GetPendingBytes()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return write_buffer_->PendingBytes();
+	}
+
+	// ԲС threshold ֽڵĸʹ MSG_ZEROCOPY ͣthreshold Ϊ 0 ʱرգsocket ֧ʱ false
+	// ڴں֪ͨǰдã÷޸ Send  shared_ptr ݡ
+	bool SetZeroCopy(uint32_t threshold);
+
+	ZeroCopyStats GetZeroCopyStats()
+	{ 
+		std::lock_guard<std::mutex> lock(mutex_);
+		return write_buffer_->GetZeroCopyStats(); 
+	}
 
 	bool IsClosed() const 
 	{ return is_closed_; }
@@ -80,6 +116,7 @@ protected:
 	std::unique_ptr<xop::BufferReader> read_buffer_;	// ڽݡ
 	std::unique_ptr<xop::BufferWriter> write_buffer_;	// дݴݡ
 	std::atomic_bool is_closed_;						// ԭӱǷѹرգ֤̰߳ȫ
+	std::atomic_bool is_draining_;						// ſչرУµķݣдʱرա
 
 private:
 	void Close();								// رӣԴص
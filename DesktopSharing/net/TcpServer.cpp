@@ -2,38 +2,24 @@
 #include "Acceptor.h"
 #include "EventLoop.h"
 #include "Logger.h"
+#include "SocketUtil.h"
 #include <cstdio>  
 
 using namespace xop;
 using namespace std;
 
-/*
- Acceptor صӵʱ OnConnect()  TcpConnection
-ӣӼ connections_ ӳ䡣
-öϿصӹرʱͨ AddTriggerEvent  AddTimer 첽Ƴӣȷ̰߳ȫ
-*/
+static int64_t GetMicroseconds()
+{
+	auto time_point = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(time_point.time_since_epoch()).count();
+}
+
 TcpServer::TcpServer(EventLoop* event_loop)
 	: event_loop_(event_loop)
 	, port_(0)
-	, acceptor_(new Acceptor(event_loop_))
 	, is_started_(false)
 {
-	acceptor_->SetNewConnectionCallback([this](SOCKET sockfd) {
-		//  sockfd Ѿ accept ˣ select ϵļ socket ¼Ȼ accpet  socket õ sockfd
-		// Ѿʼõ sokcet ȥʼ RtspConnectionTcpConnection 
-		TcpConnection::Ptr conn = this->OnConnect(sockfd);
-		if (conn) {
-			this->AddConnection(sockfd, conn);
-			conn->SetDisconnectCallback([this](TcpConnection::Ptr conn) {
-				auto scheduler = conn->GetTaskScheduler();
-				SOCKET sockfd = conn->GetSocket();
-				// ƳӳƳ
-				if (!scheduler->AddTriggerEvent([this, sockfd] {this->RemoveConnection(sockfd); })) {
-					scheduler->AddTimer([this, sockfd]() {this->RemoveConnection(sockfd); return false; }, 100);	// 100ms 
-				}
-			});
-		}
-	});
+
 }
 
 TcpServer::~TcpServer()
@@ -42,7 +28,9 @@ TcpServer::~TcpServer()
 }
 
 /*
- Acceptor::Listen() 
+ Acceptor  Acceptor::Listen() 
+ͨģʽֻһ׽֣ע EventLoop ĵһϣ
+Ƭʱÿһ SO_REUSEPORT ׽֣˳һһӦBPF 򷵻صľţ
 ·״̬ (is_started_)
 */
 bool TcpServer::Start(std::string ip, uint16_t port)
@@ -50,8 +38,37 @@ bool TcpServer::Start(std::string ip, uint16_t port)
 	Stop();
 
 	if (!is_started_) {
-		if (acceptor_->Listen(ip, port) < 0) {
-			return false;
+		uint32_t num_acceptors = 1;
+#if defined(__linux) || defined(__linux__) 
+		if (sharded_accept_ && event_loop_->GetThreadNum() > 1) {
+			num_acceptors = event_loop_->GetThreadNum();
+		}
+#endif
+
+		for (uint32_t n = 0; n < num_acceptors; n++) {
+			TaskScheduler* task_scheduler = nullptr;
+			if (num_acceptors > 1) {
+				task_scheduler = event_loop_->GetTaskScheduler(n).get();
+			}
+
+			std::unique_ptr<Acceptor> acceptor(new Acceptor(event_loop_, task_scheduler));
+			acceptor->SetNewConnectionCallback([this, task_scheduler](SOCKET sockfd) {
+				this->NewConnection(sockfd, task_scheduler);
+			});
+			if (acceptor->Listen(ip, port) < 0) {
+				for (auto& iter : acceptors_) {
+					iter->Close();
+				}
+				acceptors_.clear();
+				return false;
+			}
+			acceptors_.push_back(std::move(acceptor));
+		}
+
+		if (num_acceptors > 1 && cpu_steering_) {
+			if (!SocketUtil::SetReusePortCpuSteering(acceptors_[0]->GetSocket(), num_acceptors)) {
+				LOG_INFO("[TcpServer] reuseport cpu steering is not supported, using kernel hash.\n");
+			}
 		}
 
 		port_ = port;
@@ -66,30 +83,188 @@ bool TcpServer::Start(std::string ip, uint16_t port)
 void TcpServer::Stop()
 {
 	if (is_started_) {
-		// 1. Ͽ
-		mutex_.lock();
-		for (auto iter : connections_) {
-			iter.second->Disconnect(); // 첽ر
+		DrainOptions options;
+		options.flush_pending = false;	// ֱӶϿȴд
+		this->Drain(options);
+	}	
+}
+
+/*
+ƽֹͣ׶νУÿ׶μʱ
+1. رռٽӡ
+2. дΪյȹرգDisconnectAfterFlush ڵ߳ڷֻΪջرգ
+3. Ӳٽݣݺйرգflush_pending Ϊ false ʱ
+4. ѵδرյǿƶϿ close_timeout_ms ڵȴȫͷš
+ӵƳڸԵĵ߳ڽУ removed_ ϵȴѯ
+ڵ߳ڵʱ̵߳Ƴ޷ִУн׶ζȴֱǿƶϿ
+ӵĽӿʱ mutex_ӹرʱĻصᷴȡ
+*/
+DrainStats TcpServer::Drain(const DrainOptions& options)
+{
+	DrainStats stats;
+	if (!is_started_) {
+		return stats;
+	}
+
+	bool in_loop = this->IsInLoopThread();
+	if (in_loop) {
+		LOG_WARNING("[TcpServer] Drain() called on a scheduler thread, closing connections without waiting.\n");
+	}
+
+	int64_t begin = GetMicroseconds();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(in_loop ? 0 : options.flush_timeout_ms);
+
+	// 1. رռ
+	for (auto& iter : acceptors_) {
+		iter->Close();
+	}
+	is_started_ = false;
+	int64_t phase_begin = GetMicroseconds();
+	stats.stop_accept_us = phase_begin - begin;
+
+	// 2. رտ
+	std::vector<TcpConnection::Ptr> idle;
+	std::vector<TcpConnection::Ptr> busy;
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		for (auto& iter : connections_) {
+			idle.push_back(iter.second);
+		}
+	}
+	stats.connections = (uint32_t)idle.size();
+	for (size_t n = 0; n < idle.size(); ) {
+		uint64_t pending_bytes = idle[n]->GetPendingBytes();
+		stats.pending_bytes += pending_bytes;
+		if (pending_bytes > 0) {
+			busy.push_back(idle[n]);
+			idle[n] = idle.back();
+			idle.pop_back();
+			continue;
+		}
+		idle[n]->DisconnectAfterFlush();
+		n++;
+	}
+	stats.idle = (uint32_t)idle.size();
+	this->WaitRemoved(idle, deadline);
+	int64_t now = GetMicroseconds();
+	stats.idle_us = now - phase_begin;
+	phase_begin = now;
+
+	// 3. ӷݺر
+	if (options.flush_pending) {
+		for (auto& conn : busy) {
+			conn->DisconnectAfterFlush();
 		}
-		mutex_.unlock();
+		stats.flushed = (uint32_t)busy.size() - this->WaitRemoved(busy, deadline);
+		now = GetMicroseconds();
+		stats.flush_us = now - phase_begin;
+		phase_begin = now;
+	}
+
+	// 4. ǿƶϿʣӣڵȴȫͷ
+	std::vector<TcpConnection::Ptr> rest;
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		for (auto& iter : connections_) {
+			rest.push_back(iter.second);
+		}
+	}
+	for (auto& conn : rest) {
+		conn->Disconnect();
+	}
+	stats.forced = (uint32_t)rest.size();
+	deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(in_loop ? 0 : options.close_timeout_ms);
+	stats.unreleased = this->WaitRemoved(rest, deadline);
+	now = GetMicroseconds();
+	stats.close_us = now - phase_begin;
+	stats.total_us = now - begin;
+
+	this->ReleaseInLoop(idle);
+	this->ReleaseInLoop(busy);
+	this->ReleaseInLoop(rest);
 
-		// 2. رռ
-		acceptor_->Close();
-		is_started_ = false;
+	if (stats.connections > 0) {
+		LOG_INFO("[TcpServer] drained %u connections (idle %u, flushed %u, forced %u, %llu bytes pending) in %lld ms: "
+			"stop accept %lld us, idle %lld us, flush %lld us, close %lld us\n",
+			stats.connections, stats.idle, stats.flushed, stats.forced, (unsigned long long)stats.pending_bytes,
+			(long long)(stats.total_us / 1000),
+			(long long)stats.stop_accept_us, (long long)stats.idle_us, (long long)stats.flush_us, (long long)stats.close_us);
+	}
+	if (stats.unreleased > 0 && !in_loop) {
+		LOG_WARNING("[TcpServer] %u connections were not released within %u ms.\n", stats.unreleased, options.close_timeout_ms);
+	}
+	return stats;
+}
 
-		// 3. ȴԴͷ
-		while (1) {
-			Timer::Sleep(10); //  10ms æȴ
-			if (connections_.empty()) {
-				break;
+/*
+ȴ conns еӶ connections_ Ƴȵ deadline
+ָȽϣ socket õӰ졣޵ʱδƳ
+*/
+uint32_t TcpServer::WaitRemoved(const std::vector<TcpConnection::Ptr>& conns, const std::chrono::steady_clock::time_point& deadline)
+{
+	uint32_t remaining = 0;
+	auto count_remaining = [this, &conns, &remaining]() {
+		remaining = 0;
+		for (auto& conn : conns) {
+			auto iter = connections_.find(conn->GetSocket());
+			if (iter != connections_.end() && iter->second == conn) {
+				remaining += 1;
 			}
 		}
-	}	
+		return remaining == 0;
+	};
+
+	std::unique_lock<std::mutex> locker(mutex_);
+	removed_.wait_until(locker, deadline, count_remaining);
+	return remaining;
 }
 
-TcpConnection::Ptr TcpServer::OnConnect(SOCKET sockfd)
+bool TcpServer::IsInLoopThread()
 {
-	return std::make_shared<TcpConnection>(event_loop_->GetTaskScheduler().get(), sockfd);
+	for (uint32_t n = 0; n < event_loop_->GetThreadNum(); n++) {
+		auto task_scheduler = event_loop_->GetTaskScheduler(n);
+		if (task_scheduler && task_scheduler->IsInLoopThread()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+TcpConnection::Ptr TcpServer::OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler)
+{
+	return std::make_shared<TcpConnection>(task_scheduler, sockfd);
+}
+
+/*
+ѡƬʱʹýӵĵ EventLoop ѯ䡣
+ OnConnect()  TcpConnection connections_ ӳ䡣
+öϿصӹرʱͨ AddTriggerEvent  AddTimer 첽Ƴӣȷ̰߳ȫ
+*/
+void TcpServer::NewConnection(SOCKET sockfd, TaskScheduler* task_scheduler)
+{
+	if (task_scheduler == nullptr) {
+		task_scheduler = event_loop_->GetTaskScheduler().get();
+	}
+
+	//  sockfd Ѿ accept ˣ select ϵļ socket ¼Ȼ accpet  socket õ sockfd
+	// Ѿʼõ sokcet ȥʼ RtspConnectionTcpConnection 
+	TcpConnection::Ptr conn = this->OnConnect(sockfd, task_scheduler);
+	if (conn) {
+		uint32_t threshold = zerocopy_threshold_;
+		if (threshold > 0 && !conn->SetZeroCopy(threshold)) {
+			zerocopy_threshold_ = 0;
+			LOG_INFO("[TcpServer] MSG_ZEROCOPY is not supported, using copied send.\n");
+		}
+		this->AddConnection(sockfd, conn);
+		conn->SetDisconnectCallback([this](TcpConnection::Ptr conn) {
+			auto scheduler = conn->GetTaskScheduler();
+			SOCKET sockfd = conn->GetSocket();
+			// ƳӳƳ
+			if (!scheduler->AddTriggerEvent([this, sockfd] {this->RemoveConnection(sockfd); })) {
+				scheduler->AddTimer([this, sockfd]() {this->RemoveConnection(sockfd); return false; }, 100);	// 100ms 
+			}
+		});
+	}
 }
 
 void TcpServer::AddConnection(SOCKET sockfd, TcpConnection::Ptr tcpConn)
@@ -102,4 +277,19 @@ void TcpServer::RemoveConnection(SOCKET sockfd)
 {
 	std::lock_guard<std::mutex> locker(mutex_);
 	connections_.erase(sockfd);
+	removed_.notify_all();
+}
+
+/*
+Drain() ռͨӵһãͶݵͷţڵִ߳С
+Ͷʧܣʱڵ߳ͷš
+*/
+void TcpServer::ReleaseInLoop(std::vector<TcpConnection::Ptr>& conns)
+{
+	for (auto& conn : conns) {
+		// ƶ񣬵̲߳ٱ
+		TaskScheduler* task_scheduler = conn->GetTaskScheduler();
+		task_scheduler->AddTriggerEvent([released = std::move(conn)]() {});
+	}
+	conns.clear();
 }
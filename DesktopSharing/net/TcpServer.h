@@ -17,14 +17,19 @@ TcpServer 
     TcpConnection  HandleRead/HandleWrite 
 4. ӹر
      DisconnectCallback connections_ Ƴ
-5. û Stop()
-    ر AcceptorϿӣȴԴͷ
+5. û Stop()  Drain()
+    ر AcceptorȹرտӣDrainڷдرӣ
+       ʱǿƶϿϵȴ connections_ 
 */
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <string>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 #include "Socket.h"
 #include "TcpConnection.h"
 
@@ -34,6 +39,30 @@ namespace xop
 class Acceptor;
 class EventLoop;
 
+// Drain() 
+struct DrainOptions
+{
+	bool flush_pending = true;			// رǰдеݣٽݣ
+	uint32_t flush_timeout_ms = 5000;	// ӹرݷ͵ޣʱǿƶϿ
+	uint32_t close_timeout_ms = 1000;	// ǿƶϿȴͷŵޣ߳ʱһֱȥ
+};
+
+// Drain() ׶ʱ΢룩
+struct DrainStats
+{
+	uint32_t connections = 0;		// ʼʱ
+	uint32_t idle = 0;				// дΪաȹرյ
+	uint32_t flushed = 0;			// ڷݺرյ
+	uint32_t forced = 0;			// ʱ flush_pending Ϊ falseǿƶϿ
+	uint32_t unreleased = 0;		// ǿƶϿδͷŵ߳
+	uint64_t pending_bytes = 0;		// ʼʱдд͵ֽ֮
+	int64_t stop_accept_us = 0;		// رռ
+	int64_t idle_us = 0;			// رտ
+	int64_t flush_us = 0;			// ȴӷ
+	int64_t close_us = 0;			// ǿƶϿȴʣͷ
+	int64_t total_us = 0;
+};
+
 class TcpServer
 {
 public:	
@@ -42,8 +71,24 @@ public:
 
 	// ʼָ IP Ͷ˿ڡ
 	virtual bool Start(std::string ip, uint16_t port);
-	// ֹͣرӲͷԴ
+	// ֹͣرӲͷԴȴͻеݣ
 	virtual void Stop();
+	// ƽֹֹͣͣӣȹرտӣڷݺرգ
+	// ʱǿƶϿͷŻ close_timeout_ms ں󷵻ءǰſĽڵ㡣
+	// Ӧڵ֮߳ãӵƳڵִ߳Уڵ߳ڵʱȴֱǿƶϿ
+	DrainStats Drain(const DrainOptions& options = DrainOptions());
+
+	// Ƭ Linux Start() ֮ǰãÿ TaskScheduler һ SO_REUSEPORT ׽֣
+	// ں֮ӣӽĵپһ
+	// cpu_steering:  BPF 򣬰 SYN  CPU ѡ׽֣cpu % 
+	// ʺϵ߳ΰ CPU 0..N-1 ϵĲ
+	void SetShardedAccept(bool enable, bool cpu_steering = false)
+	{ sharded_accept_ = enable; cpu_steering_ = cpu_steering; }
+
+	// 㿽ͣ Linux 4.14+ϲС threshold ֽڵĸʹ MSG_ZEROCOPY
+	// Сʱ̶ҳֵ֪ͨһȡʮ KBɸ ZeroCopyStats 
+	void SetZeroCopy(bool enable, uint32_t threshold = 64 * 1024)
+	{ zerocopy_threshold_ = enable ? threshold : 0; }
 
 	std::string GetIPAddress() const
 	{ return ip_; }
@@ -52,19 +97,31 @@ public:
 	{ return port_; }
 
 protected:
-	// 麯 TcpConnection 󣨿ɱาʵԶ߼
-	virtual TcpConnection::Ptr OnConnect(SOCKET sockfd);
+	// 麯 TcpConnection 󣨿ɱาʵԶ߼task_scheduler Ϊĵ
+	virtual TcpConnection::Ptr OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler);
 	// ӵ connections_ ӳ䡣
 	virtual void AddConnection(SOCKET sockfd, TcpConnection::Ptr tcp_conn);
 	//  connections_ Ƴָӡ
 	virtual void RemoveConnection(SOCKET sockfd);
+	// Acceptor صѡƬʱΪӵĵǼӡ
+	void NewConnection(SOCKET sockfd, TaskScheduler* task_scheduler);
+	//  removed_ ϵȴ conns ȫƳ deadline ڣδƳĸ
+	uint32_t WaitRemoved(const std::vector<TcpConnection::Ptr>& conns, const std::chrono::steady_clock::time_point& deadline);
+	// ߳ǷΪ event_loop_ ĳ̡߳
+	bool IsInLoopThread();
+	//  conns еýĵ߳ͷţһõر fd ȣڵִ߳С
+	void ReleaseInLoop(std::vector<TcpConnection::Ptr>& conns);
 
 	EventLoop* event_loop_;					// ¼ѭ Acceptor ӵ I/O ¼
 	uint16_t port_;
 	std::string ip_;
-	std::unique_ptr<Acceptor> acceptor_;	// ӡ
+	std::vector<std::unique_ptr<Acceptor>> acceptors_;	// ӣƬʱÿһ
 	bool is_started_;
+	bool sharded_accept_ = false;
+	bool cpu_steering_ = false;
+	std::atomic<uint32_t> zerocopy_threshold_{ 0 };	// 0 ʾʹ㿽socket ֧ʱ 0
 	std::mutex mutex_;						//  connections_ ̰߳ȫʡ
+	std::condition_variable removed_;		// RemoveConnection() ֪ͨDrain() ȴͷš
 	std::unordered_map<SOCKET, TcpConnection::Ptr> connections_;	// 洢лԾӣΪ׽
 };
 
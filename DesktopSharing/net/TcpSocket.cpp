@@ -55,7 +55,12 @@ SOCKET TcpSocket::Accept()
 	struct sockaddr_in addr = {0};
 	socklen_t addrlen = sizeof addr;
 
+#if defined(__linux) || defined(__linux__) 
+	// һϵͳͬʱ÷ close-on-exec
+	SOCKET socket_fd = ::accept4(sockfd_, (struct sockaddr*)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#elif defined(WIN32) || defined(_WIN32)
 	SOCKET socket_fd = ::accept(sockfd_, (struct sockaddr*)&addr, &addrlen);
+#endif
 	return socket_fd;
 }
 
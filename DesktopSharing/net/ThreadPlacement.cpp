@@ -0,0 +1,269 @@
+#include "ThreadPlacement.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__linux) || defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#elif defined(WIN32) || defined(_WIN32)
+#include <windows.h>
+#endif
+
+using namespace xop;
+
+#if defined(__linux) || defined(__linux__)
+
+static std::string ReadLine(const std::string& path)
+{
+	std::ifstream ifs(path);
+	std::string line;
+	std::getline(ifs, line);
+	return line;
+}
+
+//  sysfs е CPU б "0-3,8-11"
+static std::vector<int> ParseCpuList(const std::string& list)
+{
+	std::vector<int> cpus;
+	const char* p = list.c_str();
+
+	while (*p) {
+		char* end = nullptr;
+		long first = strtol(p, &end, 10);
+		if (end == p) {
+			break;
+		}
+		long last = first;
+		p = end;
+		if (*p == '-') {
+			last = strtol(p + 1, &end, 10);
+			p = end;
+		}
+		for (long cpu = first; cpu <= last; cpu++) {
+			cpus.push_back((int)cpu);
+		}
+		if (*p == ',') {
+			p++;
+		}
+		else {
+			break;
+		}
+	}
+
+	return cpus;
+}
+
+static bool IsFirstSibling(int cpu)
+{
+	std::vector<int> siblings = ParseCpuList(
+		ReadLine("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"));
+	return siblings.empty() || siblings.front() == cpu;
+}
+
+static int GetNiceValue(int priority)
+{
+	switch (priority)
+	{
+	case TASK_SCHEDULER_PRIORITY_LOW:
+		return 10;
+	case TASK_SCHEDULER_PRIORITYO_HIGH:
+		return -5;
+	case TASK_SCHEDULER_PRIORITY_HIGHEST:
+		return -10;
+	case TASK_SCHEDULER_PRIORITY_REALTIME:
+		return -20;
+	default:
+		return 0;
+	}
+}
+
+#endif
+
+std::vector<int> ThreadPlacement::GetDefaultLayout()
+{
+	std::vector<int> layout;
+
+#if defined(__linux) || defined(__linux__)
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		return layout;
+	}
+
+	//  NUMA ڵ飬û NUMA ϢʱȫΪڵ 0
+	std::vector<std::vector<int>> nodes;
+	for (int node = 0; ; node++) {
+		std::string cpulist = ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if (cpulist.empty()) {
+			break;
+		}
+		nodes.push_back(ParseCpuList(cpulist));
+	}
+	if (nodes.empty()) {
+		nodes.resize(1);
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			nodes[0].push_back(cpu);
+		}
+	}
+
+	for (auto& cpus : nodes) {
+		std::vector<int> threads;
+		for (int cpu : cpus) {
+			if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+				continue;
+			}
+			if (IsFirstSibling(cpu)) {
+				layout.push_back(cpu);
+			}
+			else {
+				threads.push_back(cpu);
+			}
+		}
+		layout.insert(layout.end(), threads.begin(), threads.end());
+	}
+#elif defined(WIN32) || defined(_WIN32)
+	DWORD_PTR process_mask = 0, system_mask = 0;
+	if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+		for (int cpu = 0; cpu < (int)(sizeof(DWORD_PTR) * 8); cpu++) {
+			if (process_mask & ((DWORD_PTR)1 << cpu)) {
+				layout.push_back(cpu);
+			}
+		}
+	}
+#endif
+
+	return layout;
+}
+
+int ThreadPlacement::GetNumaNode(int cpu)
+{
+#if defined(__linux) || defined(__linux__)
+	for (int node = 0; ; node++) {
+		std::string cpulist = ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if (cpulist.empty()) {
+			break;
+		}
+		std::vector<int> cpus = ParseCpuList(cpulist);
+		if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+			return node;
+		}
+	}
+#endif
+	return 0;
+}
+
+bool ThreadPlacement::SetAffinity(int cpu)
+{
+	if (cpu < 0) {
+		return false;
+	}
+
+#if defined(__linux) || defined(__linux__)
+	if (cpu >= CPU_SETSIZE) {
+		return false;
+	}
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+#elif defined(WIN32) || defined(_WIN32)
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8)) {
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+	return false;
+#endif
+}
+
+bool ThreadPlacement::SetPriority(int priority, bool sched_fifo)
+{
+#if defined(__linux) || defined(__linux__)
+	// δʽָʱּ̳ĵȲԺ nice ֵ
+	if (priority == TASK_SCHEDULER_PRIORITY_DEFAULT) {
+		return true;
+	}
+
+	if (sched_fifo && priority >= TASK_SCHEDULER_PRIORITY_HIGHEST) {
+		int min = sched_get_priority_min(SCHED_FIFO);
+		int max = sched_get_priority_max(SCHED_FIFO);
+		struct sched_param param;
+		param.sched_priority = priority == TASK_SCHEDULER_PRIORITY_REALTIME ? (min + max) / 2 : min;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+			return true;
+		}
+	}
+
+	// nice ֵ Linux ̼߳
+	pid_t tid = (pid_t)syscall(SYS_gettid);
+	return setpriority(PRIO_PROCESS, (id_t)tid, GetNiceValue(priority)) == 0;
+#elif defined(WIN32) || defined(_WIN32)
+	int thread_priority = THREAD_PRIORITY_NORMAL;
+	switch (priority)
+	{
+	case TASK_SCHEDULER_PRIORITY_LOW:
+		thread_priority = THREAD_PRIORITY_BELOW_NORMAL;
+		break;
+	case TASK_SCHEDULER_PRIORITY_NORMAL:
+		thread_priority = THREAD_PRIORITY_NORMAL;
+		break;
+	case TASK_SCHEDULER_PRIORITYO_HIGH:
+		thread_priority = THREAD_PRIORITY_ABOVE_NORMAL;
+		break;
+	case TASK_SCHEDULER_PRIORITY_HIGHEST:
+		thread_priority = THREAD_PRIORITY_HIGHEST;
+		break;
+	case TASK_SCHEDULER_PRIORITY_DEFAULT:
+	case TASK_SCHEDULER_PRIORITY_REALTIME:
+		thread_priority = THREAD_PRIORITY_TIME_CRITICAL;
+		break;
+	}
+	return SetThreadPriority(GetCurrentThread(), thread_priority) != 0;
+#else
+	return false;
+#endif
+}
+
+std::string ThreadPlacement::Describe()
+{
+	char buf[256] = { 0 };
+
+#if defined(__linux) || defined(__linux__)
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	int allowed = 0;
+	if (pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0) {
+		allowed = CPU_COUNT(&cpuset);
+	}
+
+	int policy = SCHED_OTHER;
+	struct sched_param param;
+	param.sched_priority = 0;
+	pthread_getschedparam(pthread_self(), &policy, &param);
+
+	int cpu = sched_getcpu();
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+
+	if (policy == SCHED_FIFO) {
+		snprintf(buf, sizeof(buf), "cpu %d (node %d), allowed cpus %d, SCHED_FIFO priority %d",
+			cpu, GetNumaNode(cpu), allowed, param.sched_priority);
+	}
+	else {
+		snprintf(buf, sizeof(buf), "cpu %d (node %d), allowed cpus %d, SCHED_OTHER nice %d",
+			cpu, GetNumaNode(cpu), allowed, errno ? 0 : nice);
+	}
+#elif defined(WIN32) || defined(_WIN32)
+	snprintf(buf, sizeof(buf), "cpu %lu, priority %d",
+		GetCurrentProcessorNumber(), GetThreadPriority(GetCurrentThread()));
+#endif
+
+	return buf;
+}
@@ -0,0 +1,58 @@
+#ifndef XOP_THREAD_PLACEMENT_H
+#define XOP_THREAD_PLACEMENT_H
+
+/*
+ThreadPlacement  EventLoop ̵߳ȼ CPU ׺ԡ
+
+WindowsȼӳΪ SetThreadPriorityʹ SetThreadAffinityMask
+         ĬϣTASK_SCHEDULER_PRIORITY_DEFAULTԭ THREAD_PRIORITY_TIME_CRITICAL
+LinuxĬϲ޸߳ȼʽָʱӳΪ nice ֵLOW=10, NORMAL=0, HIGH=-5, HIGHEST=-10, REALTIME=-20
+        sched_fifo ʱ HIGHEST/REALTIME  SCHED_FIFOҪ CAP_SYS_NICEʧʱ˻ nice
+       ʹ pthread_setaffinity_np
+δָ CPU бʱ NUMA ڵУһڵ㣬һڵ㣻ڵÿ˵ĵһ߼ˣ
+ų̣̹߳߳ͬһ L3 ڴֲἷͬһϡ
+öڵ߳ڲ¼ѭ֮ǰɣʧֻ¼־ӰС
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define TASK_SCHEDULER_PRIORITY_DEFAULT  -1
+#define TASK_SCHEDULER_PRIORITY_LOW       0
+#define TASK_SCHEDULER_PRIORITY_NORMAL    1
+#define TASK_SCHEDULER_PRIORITYO_HIGH     2
+#define TASK_SCHEDULER_PRIORITY_HIGHEST   3
+#define TASK_SCHEDULER_PRIORITY_REALTIME  4
+
+namespace xop
+{
+
+struct ThreadPlacementOptions
+{
+	int  priority = TASK_SCHEDULER_PRIORITY_DEFAULT;	// ߳ȼTASK_SCHEDULER_PRIORITY_*DEFAULT  Linux ϲ޸
+	bool sched_fifo = false;	// LinuxHIGHEST/REALTIME ʹ SCHED_FIFO
+	bool pin_cpu = false;		// Ƿÿ̰߳󶨵һ CPU
+	std::vector<int> cpus;		//  n ̰߳ cpus[n % cpus.size()]Ϊʱʹ NUMA ֪Ĭϲ
+};
+
+class ThreadPlacement
+{
+public:
+	//  CPU Ĭ˳ֻǰе CPU
+	static std::vector<int> GetDefaultLayout();
+
+	// CPU ڵ NUMA ڵ㣬δ֪ʱ 0
+	static int GetNumaNode(int cpu);
+
+	// ºڵ̡߳
+	static bool SetAffinity(int cpu);
+	static bool SetPriority(int priority, bool sched_fifo);
+
+	// ߳ʵЧķ־
+	static std::string Describe();
+};
+
+}
+
+#endif
@@ -87,14 +87,33 @@ private:
 	int64_t  next_timeout_ = 0;
 };
 
-class TimerQueue
+enum TimerQueueType
+{
+	TIMER_QUEUE_MAP   = 0,	// std::map, O(log n), millisecond precision (default)
+	TIMER_QUEUE_WHEEL = 1,	// hierarchical timing wheel, O(1) add/remove, see TimerWheel.h
+};
+
+// Interface shared by TimerQueue and TimerWheel; TaskScheduler holds one of them
+class TimerQueueBase
+{
+public:
+	virtual ~TimerQueueBase() {}
+
+	virtual TimerId AddTimer(const TimerEvent& event, uint32_t msec) = 0;
+	virtual void RemoveTimer(TimerId timerId) = 0;
+
+	virtual int64_t GetTimeRemaining() = 0;
+	virtual void HandleTimerEvent() = 0;
+};
+
+class TimerQueue : public TimerQueueBase
 {
 public:
-	TimerId AddTimer(const TimerEvent& event, uint32_t msec);
-	void RemoveTimer(TimerId timerId);
+	virtual TimerId AddTimer(const TimerEvent& event, uint32_t msec) override;
+	virtual void RemoveTimer(TimerId timerId) override;
 
-	int64_t GetTimeRemaining();
-	void HandleTimerEvent();
+	virtual int64_t GetTimeRemaining() override;
+	virtual void HandleTimerEvent() override;
 
 private:
 	int64_t GetTimeNow();
@@ -0,0 +1,431 @@
+#include "TimerWheel.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace xop;
+using namespace std::chrono;
+
+namespace
+{
+
+inline int CountTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER)
+	unsigned long n = 0;
+	if (_BitScanForward(&n, (unsigned long)x)) {
+		return (int)n;
+	}
+	_BitScanForward(&n, (unsigned long)(x >> 32));
+	return (int)n + 32;
+#else
+	int n = 0;
+	while (!(x & 1)) {
+		x >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+// λͼ [start, bits) Χڲҵһλ±꣬û򷵻 -1
+int FindFirstBit(const uint64_t* words, uint32_t bits, uint32_t start)
+{
+	for (uint32_t w = start / 64; w < bits / 64; w++) {
+		uint64_t word = words[w];
+		if (w == start / 64) {
+			word &= ~0ULL << (start % 64);
+		}
+		if (word) {
+			return (int)(w * 64 + CountTrailingZeros(word));
+		}
+	}
+	return -1;
+}
+
+// βң start ʼҵһλ±ꡣ
+int FindNextBit(const uint64_t* words, uint32_t bits, uint32_t start)
+{
+	int index = FindFirstBit(words, bits, start);
+	if (index < 0 && start > 0) {
+		index = FindFirstBit(words, bits, 0);
+	}
+	return index;
+}
+
+}
+
+TimerWheel::TimerWheel(uint32_t tick_us)
+	: tick_us_(tick_us > 0 ? tick_us : 1000)
+{
+	start_us_ = GetTimeNowUs();
+
+	for (uint32_t n = 0; n < kLevel0Size; n++) {
+		level0_[n] = kInvalidIndex;
+	}
+	for (int level = 0; level < kLevels - 1; level++) {
+		for (uint32_t n = 0; n < kLevelNSize; n++) {
+			levels_[level][n] = kInvalidIndex;
+		}
+		bitmapn_[level] = 0;
+	}
+	for (uint32_t n = 0; n < kLevel0Size / 64; n++) {
+		bitmap0_[n] = 0;
+	}
+}
+
+TimerWheel::~TimerWheel()
+{
+
+}
+
+int64_t TimerWheel::GetTimeNowUs()
+{
+	auto time_point = steady_clock::now();
+	return duration_cast<microseconds>(time_point.time_since_epoch()).count();
+}
+
+uint64_t TimerWheel::GetTickNow()
+{
+	int64_t elapsed = GetTimeNowUs() - start_us_;
+	return elapsed > 0 ? (uint64_t)elapsed / tick_us_ : 0;
+}
+
+TimerId TimerWheel::AddTimer(const TimerEvent& event, uint32_t msec)
+{
+	//  Timer һ£0 밴 1 봦
+	uint64_t interval_us = (uint64_t)(msec > 0 ? msec : 1) * 1000;
+	uint64_t interval_ticks = (interval_us + tick_us_ - 1) / tick_us_;
+	if (interval_ticks > 0xFFFFFFFF) {
+		interval_ticks = 0xFFFFFFFF;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	uint32_t index = AllocNode();
+	if (index == kInvalidIndex) {
+		return 0;
+	}
+
+	// ԵǰʵʱΪ׼current_tick_ ¼ѭУ tick һ
+	TimerNode& node = nodes_[index];
+	node.event_callback = event;
+	node.interval_ticks = (uint32_t)interval_ticks;
+	node.expire_tick = GetTickNow() + interval_ticks;
+	if (node.expire_tick <= current_tick_) {
+		node.expire_tick = current_tick_ + 1;
+	}
+	Link(index);
+	count_ += 1;
+
+	return ((TimerId)(node.generation & ((1 << (32 - kIndexBits)) - 1)) << kIndexBits) | (index + 1);
+}
+
+void TimerWheel::RemoveTimer(TimerId timer_id)
+{
+	TimerEvent event_callback;
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		uint32_t index = 0;
+		TimerNode* node = FindNode(timer_id, &index);
+		if (node == nullptr) {
+			return;
+		}
+
+		if (node->state == kNodeLinked) {
+			Unlink(index);
+			count_ -= 1;
+			event_callback.swap(node->event_callback);
+			FreeNode(index);
+		}
+		else if (node->state == kNodeRunning) {
+			node->state = kNodeCancelled;
+		}
+	}
+
+	// صĶٴε RemoveTimer 
+}
+
+size_t TimerWheel::Size()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	return count_;
+}
+
+int64_t TimerWheel::GetTimeRemaining()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	if (count_ == 0) {
+		return -1;
+	}
+
+	int64_t expire_us = start_us_ + (int64_t)((current_tick_ + NextTickDistance()) * tick_us_);
+	int64_t remaining_us = expire_us - GetTimeNowUs();
+	if (remaining_us <= 0) {
+		return 0;
+	}
+
+	// 뼰ϵ tick ȡǰתǺ tick ȡһ 0 ʱѯ
+	if (tick_us_ >= 1000) {
+		return (remaining_us + 999) / 1000;
+	}
+	return remaining_us / 1000;
+}
+
+void TimerWheel::HandleTimerEvent()
+{
+	uint64_t now_tick = GetTickNow();
+	std::vector<Expired> expired;
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		while (current_tick_ < now_tick) {
+			if (count_ == 0) {
+				current_tick_ = now_tick;
+				break;
+			}
+
+			uint64_t next_tick = current_tick_ + 1;
+			if (next_tick & (kLevel0Size - 1)) {
+				// λͼ 0 ĿղۣԶһνλ
+				int index = FindFirstBit(bitmap0_, kLevel0Size, (uint32_t)(next_tick & (kLevel0Size - 1)));
+				uint64_t target_tick = index >= 0
+					? (next_tick & ~(uint64_t)(kLevel0Size - 1)) + index
+					: (next_tick | (kLevel0Size - 1)) + 1;
+				if (target_tick > now_tick) {
+					current_tick_ = now_tick;
+					break;
+				}
+				next_tick = target_tick;
+			}
+
+			current_tick_ = next_tick;
+			if ((current_tick_ & (kLevel0Size - 1)) == 0) {
+				for (int level = 1; level < kLevels; level++) {
+					Cascade(level);
+					if (((current_tick_ >> Shift(level)) & (kLevelNSize - 1)) != 0) {
+						break;
+					}
+				}
+			}
+
+			Expire((uint32_t)(current_tick_ & (kLevel0Size - 1)));
+		}
+
+		if (expired_.empty()) {
+			return;
+		}
+		expired.swap(expired_);
+	}
+
+	// ִУûصصп/ɾʱɾԼ
+	for (auto& iter : expired) {
+		iter.repeat = iter.event_callback();
+	}
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		for (auto& iter : expired) {
+			TimerNode& node = nodes_[iter.index];
+			if (iter.repeat && node.state == kNodeRunning) {
+				node.event_callback.swap(iter.event_callback);
+				node.expire_tick = current_tick_ + node.interval_ticks;
+				Link(iter.index);
+				count_ += 1;
+			}
+			else {
+				FreeNode(iter.index);
+			}
+		}
+	}
+
+	// ظĻص vector ´ʹ
+	expired.clear();
+	std::lock_guard<std::mutex> locker(mutex_);
+	if (expired_.empty()) {
+		expired_.swap(expired);
+	}
+}
+
+uint32_t TimerWheel::AllocNode()
+{
+	uint32_t index = free_head_;
+	if (index != kInvalidIndex) {
+		free_head_ = nodes_[index].next;
+	}
+	else if (nodes_.size() < kMaxTimers) {
+		index = (uint32_t)nodes_.size();
+		nodes_.emplace_back();
+	}
+	else {
+		return kInvalidIndex;
+	}
+
+	nodes_[index].state = kNodeLinked;
+	return index;
+}
+
+void TimerWheel::FreeNode(uint32_t index)
+{
+	TimerNode& node = nodes_[index];
+	node.state = kNodeFree;
+	node.generation += 1;
+	node.next = free_head_;
+	free_head_ = index;
+}
+
+TimerWheel::TimerNode* TimerWheel::FindNode(TimerId timer_id, uint32_t* index)
+{
+	uint32_t slot = timer_id & kMaxTimers;
+	if (slot == 0 || slot > nodes_.size()) {
+		return nullptr;
+	}
+
+	TimerNode& node = nodes_[slot - 1];
+	uint32_t generation = node.generation & ((1 << (32 - kIndexBits)) - 1);
+	if (node.state == kNodeFree || generation != (timer_id >> kIndexBits)) {
+		return nullptr;
+	}
+
+	*index = slot - 1;
+	return &node;
+}
+
+void TimerWheel::Link(uint32_t index)
+{
+	TimerNode& node = nodes_[index];
+	uint64_t delta = node.expire_tick - current_tick_;
+	int level = 0;
+	uint32_t slot = 0;
+
+	if (delta < kLevel0Size) {
+		slot = (uint32_t)(node.expire_tick & (kLevel0Size - 1));
+	}
+	else {
+		uint64_t expire_tick = node.expire_tick;
+		for (level = 1; level < kLevels; level++) {
+			if (delta < (1ULL << (Shift(level) + kLevelNBits))) {
+				break;
+			}
+		}
+		if (level == kLevels) {
+			// ʱַΧȷ߲ԶĲۣʱʵʱɢ
+			level = kLevels - 1;
+			expire_tick = current_tick_ + (1ULL << (Shift(level) + kLevelNBits)) - 1;
+		}
+		slot = (uint32_t)((expire_tick >> Shift(level)) & (kLevelNSize - 1));
+	}
+
+	uint32_t* slots = Slots(level);
+	node.state = kNodeLinked;
+	node.slot_level = (uint8_t)level;
+	node.slot_index = (uint16_t)slot;
+	node.prev = kInvalidIndex;
+	node.next = slots[slot];
+	if (node.next != kInvalidIndex) {
+		nodes_[node.next].prev = index;
+	}
+	slots[slot] = index;
+
+	if (level == 0) {
+		bitmap0_[slot / 64] |= 1ULL << (slot % 64);
+	}
+	else {
+		bitmapn_[level - 1] |= 1ULL << slot;
+	}
+}
+
+void TimerWheel::Unlink(uint32_t index)
+{
+	TimerNode& node = nodes_[index];
+	uint32_t* slots = Slots(node.slot_level);
+	uint32_t slot = node.slot_index;
+
+	if (node.prev != kInvalidIndex) {
+		nodes_[node.prev].next = node.next;
+	}
+	else {
+		slots[slot] = node.next;
+	}
+	if (node.next != kInvalidIndex) {
+		nodes_[node.next].prev = node.prev;
+	}
+
+	if (slots[slot] == kInvalidIndex) {
+		if (node.slot_level == 0) {
+			bitmap0_[slot / 64] &= ~(1ULL << (slot % 64));
+		}
+		else {
+			bitmapn_[node.slot_level - 1] &= ~(1ULL << slot);
+		}
+	}
+}
+
+void TimerWheel::Cascade(int level)
+{
+	uint32_t* slots = Slots(level);
+	uint32_t slot = (uint32_t)((current_tick_ >> Shift(level)) & (kLevelNSize - 1));
+	uint32_t index = slots[slot];
+
+	slots[slot] = kInvalidIndex;
+	bitmapn_[level - 1] &= ~(1ULL << slot);
+
+	while (index != kInvalidIndex) {
+		uint32_t next = nodes_[index].next;
+		Link(index);
+		index = next;
+	}
+}
+
+void TimerWheel::Expire(uint32_t slot)
+{
+	uint32_t index = level0_[slot];
+
+	level0_[slot] = kInvalidIndex;
+	bitmap0_[slot / 64] &= ~(1ULL << (slot % 64));
+
+	while (index != kInvalidIndex) {
+		TimerNode& node = nodes_[index];
+		node.state = kNodeRunning;
+		expired_.emplace_back();
+		expired_.back().index = index;
+		expired_.back().event_callback.swap(node.event_callback);
+		count_ -= 1;
+		index = node.next;
+	}
+}
+
+uint64_t TimerWheel::NextTickDistance()
+{
+	//  0 Ǿȷĵʱ䣻ϲֻܸʱ䣨½磩ʱ¼㼴
+	uint64_t distance = UINT64_MAX;
+
+	uint32_t start = (uint32_t)((current_tick_ + 1) & (kLevel0Size - 1));
+	int index = FindNextBit(bitmap0_, kLevel0Size, start);
+	if (index >= 0) {
+		distance = (((uint32_t)index - start) & (kLevel0Size - 1)) + 1;
+	}
+
+	for (int level = 1; level < kLevels; level++) {
+		if (bitmapn_[level - 1] == 0) {
+			continue;
+		}
+
+		uint64_t position = current_tick_ >> Shift(level);
+		start = (uint32_t)((position + 1) & (kLevelNSize - 1));
+		index = FindNextBit(&bitmapn_[level - 1], kLevelNSize, start);
+		uint64_t steps = (((uint32_t)index - start) & (kLevelNSize - 1)) + 1;
+		uint64_t cascade_tick = (position + steps) << Shift(level);
+		if (cascade_tick - current_tick_ < distance) {
+			distance = cascade_tick - current_tick_;
+		}
+	}
+
+	return distance != UINT64_MAX ? distance : kLevel0Size;
+}
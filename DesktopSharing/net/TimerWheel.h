@@ -0,0 +1,113 @@
+#ifndef XOP_TIMER_WHEEL_H
+#define XOP_TIMER_WHEEL_H
+
+/*
+TimerWheel  TimerQueueBase ķֲʱʵ֣ std::map  TimerQueueṹͬ Linux ں 2.6  timer wheel
+
+ 5 㣺 0  256 ۣÿ 1  tick 1~4  64 ۣÿۿΪ 2^82^142^202^26  tick
+ʱ tick 뵱ǰ tick ľӦĲۣ˫/ɾ O(1)
+ 0 תһȦʱһһۡɢе²㡣
+ڴڰѵڲժ£ִлصصп԰ȫ/ɾʱ
+
+tick Ĭ 1000 ΢룬ΪǺ루 100 ΢룩ʱ GetTimeRemaining() ȡ
+ 1 ĵȴ¼ѭ 0 ʱѯɣȸߵռһЩ CPU
+ʱڵиãTimerId ɲλ±ʹɣڵ id ɾ¶ʱ
+*/
+
+#include "Timer.h"
+#include <vector>
+
+namespace xop
+{
+
+class TimerWheel : public TimerQueueBase
+{
+public:
+	TimerWheel(uint32_t tick_us = 1000);
+	virtual ~TimerWheel();
+
+	virtual TimerId AddTimer(const TimerEvent& event, uint32_t msec) override;
+	virtual void RemoveTimer(TimerId timer_id) override;
+
+	virtual int64_t GetTimeRemaining() override;
+	virtual void HandleTimerEvent() override;
+
+	size_t Size();
+
+	uint32_t GetTickUs() const
+	{ return tick_us_; }
+
+private:
+	struct TimerNode
+	{
+		TimerEvent event_callback;
+		uint64_t expire_tick = 0;
+		uint32_t interval_ticks = 0;
+		uint32_t prev = 0;
+		uint32_t next = 0;
+		uint16_t generation = 0;
+		uint8_t  state = 0;
+		uint8_t  slot_level = 0;
+		uint16_t slot_index = 0;
+	};
+
+	struct Expired
+	{
+		uint32_t index = 0;
+		TimerEvent event_callback;
+		bool repeat = false;
+	};
+
+	enum NodeState
+	{
+		kNodeFree = 0,
+		kNodeLinked,		// ĳ
+		kNodeRunning,		// ժ£صִ
+		kNodeCancelled,		// صִڼ䱻 RemoveTimerִͷ
+	};
+
+	static const int      kLevels = 5;
+	static const int      kLevel0Bits = 8;
+	static const int      kLevelNBits = 6;
+	static const uint32_t kLevel0Size = 1 << kLevel0Bits;
+	static const uint32_t kLevelNSize = 1 << kLevelNBits;
+	static const uint32_t kInvalidIndex = 0xFFFFFFFF;
+	static const uint32_t kIndexBits = 22;						// TimerId  22 λ± + 1 10 λǴ
+	static const uint32_t kMaxTimers = (1 << kIndexBits) - 1;
+
+	int64_t  GetTimeNowUs();
+	uint64_t GetTickNow();
+	uint32_t AllocNode();
+	void FreeNode(uint32_t index);
+	TimerNode* FindNode(TimerId timer_id, uint32_t* index);
+	void Link(uint32_t index);
+	void Unlink(uint32_t index);
+	void Cascade(int level);
+	void Expire(uint32_t slot);
+	uint64_t NextTickDistance();
+
+	uint32_t* Slots(int level)
+	{ return level == 0 ? level0_ : levels_[level - 1]; }
+
+	static int Shift(int level)
+	{ return level == 0 ? 0 : kLevel0Bits + (level - 1) * kLevelNBits; }
+
+	std::mutex mutex_;
+	uint32_t tick_us_ = 1000;
+	int64_t  start_us_ = 0;
+	uint64_t current_tick_ = 0;			// Ѵ tick
+	size_t   count_ = 0;				// ʱϵĶʱ
+
+	uint32_t level0_[kLevel0Size];
+	uint32_t levels_[kLevels - 1][kLevelNSize];
+	uint64_t bitmap0_[kLevel0Size / 64];	// ǿղλͼղۺͼһεʱ
+	uint64_t bitmapn_[kLevels - 1];
+
+	std::vector<TimerNode> nodes_;
+	uint32_t free_head_ = kInvalidIndex;
+	std::vector<Expired> expired_;		// ֵڵĶʱصѴӽڵƳ
+};
+
+}
+
+#endif
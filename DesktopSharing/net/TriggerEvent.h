@@ -0,0 +1,148 @@
+#ifndef XOP_TRIGGER_EVENT_H
+#define XOP_TRIGGER_EVENT_H
+
+/*
+TriggerEvent Ͷݵ TaskScheduler 첽ԭ std::function<void(void)>
+
+СŻб kInlineSize ֽڵ lambda ֱӹڶڲĴ洢
+Ͷʱѷ䣻ֲ˻Ϊϱ档
+ MpscQueue ʹʱеÿλһԤ TriggerEvent͵ع졢͵ִС
+ֻ֧ƶֿ֧ unique_ptr ȽƶĶ󣩡
+*/
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace xop
+{
+
+class TriggerEvent
+{
+public:
+	TriggerEvent() {}
+
+	template <typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, TriggerEvent>::value>::type>
+	TriggerEvent(F&& f)
+	{ Assign(std::forward<F>(f)); }
+
+	TriggerEvent(TriggerEvent&& other)
+	{ MoveFrom(other); }
+
+	TriggerEvent& operator=(TriggerEvent&& other)
+	{
+		if (this != &other) {
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	TriggerEvent(const TriggerEvent&) = delete;
+	TriggerEvent& operator=(const TriggerEvent&) = delete;
+
+	~TriggerEvent()
+	{ Reset(); }
+
+	void operator()()
+	{ invoke_(&storage_); }
+
+	explicit operator bool() const
+	{ return invoke_ != nullptr; }
+
+	void Reset()
+	{
+		if (manage_) {
+			manage_(nullptr, &storage_);
+		}
+		invoke_ = nullptr;
+		manage_ = nullptr;
+	}
+
+	// 洢С RtpConnection/RtmpConnection Ĳб
+	static const size_t kInlineSize = 48;
+
+private:
+	typedef void (*InvokeFunc)(void* storage);
+	// dst ǿգ src ƶ쵽 dst  srcdst Ϊգ src
+	typedef void (*ManageFunc)(void* dst, void* src);
+
+	template <typename F>
+	struct IsInline
+	{
+		static const bool value = sizeof(F) <= kInlineSize
+			&& alignof(F) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible<F>::value;
+	};
+
+	template <typename F>
+	static void InvokeInline(void* storage)
+	{ (*static_cast<F*>(storage))(); }
+
+	template <typename F>
+	static void ManageInline(void* dst, void* src)
+	{
+		F* f = static_cast<F*>(src);
+		if (dst) {
+			::new (dst) F(std::move(*f));
+		}
+		f->~F();
+	}
+
+	template <typename F>
+	static void InvokeHeap(void* storage)
+	{ (**static_cast<F**>(storage))(); }
+
+	template <typename F>
+	static void ManageHeap(void* dst, void* src)
+	{
+		F** f = static_cast<F**>(src);
+		if (dst) {
+			*static_cast<F**>(dst) = *f;
+		}
+		else {
+			delete *f;
+		}
+	}
+
+	template <typename F>
+	typename std::enable_if<IsInline<typename std::decay<F>::type>::value>::type
+	Assign(F&& f)
+	{
+		typedef typename std::decay<F>::type Func;
+		::new (static_cast<void*>(&storage_)) Func(std::forward<F>(f));
+		invoke_ = &InvokeInline<Func>;
+		manage_ = &ManageInline<Func>;
+	}
+
+	template <typename F>
+	typename std::enable_if<!IsInline<typename std::decay<F>::type>::value>::type
+	Assign(F&& f)
+	{
+		typedef typename std::decay<F>::type Func;
+		*reinterpret_cast<Func**>(&storage_) = new Func(std::forward<F>(f));
+		invoke_ = &InvokeHeap<Func>;
+		manage_ = &ManageHeap<Func>;
+	}
+
+	void MoveFrom(TriggerEvent& other)
+	{
+		if (other.manage_) {
+			other.manage_(&storage_, &other.storage_);
+		}
+		invoke_ = other.invoke_;
+		manage_ = other.manage_;
+		other.invoke_ = nullptr;
+		other.manage_ = nullptr;
+	}
+
+	typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type storage_;
+	InvokeFunc invoke_ = nullptr;
+	ManageFunc manage_ = nullptr;
+};
+
+}
+
+#endif
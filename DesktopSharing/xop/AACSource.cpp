@@ -9,6 +9,7 @@
 #include "AACSource.h"
 #include <stdlib.h>
 #include <cstdio>
+#include <cstring>
 #include <chrono>
 #if defined(__linux) || defined(__linux__)
 #include <sys/time.h>
@@ -84,41 +85,137 @@ string AACSource::GetAttribute()  // RFC 3640
 
 
 
-bool AACSource::HandleFrame(MediaChannelId channel_id, AVFrame frame)
+/*
+延迟预算换算为 AU 数：第一个 AU 等到后面 (max_aus_ - 1) 个 AU 到达后发出，每个 AU 持续 SAMPLES_PER_AU 个采样。
+*/
+void AACSource::SetMaxLatency(uint32_t latency_ms)
 {
-	if (frame.size > (MAX_RTP_PAYLOAD_SIZE-AU_SIZE)) {
-		return false;
-	}
+	max_latency_ms_ = latency_ms;
+	max_aus_ = 1 + (uint32_t)((uint64_t)latency_ms * samplerate_ / (1000 * SAMPLES_PER_AU));
+}
 
-	int adts_size = 0;
+/*
+RFC 3640 AAC-hbr：
+	1. 包内 AU 按顺序排列，AU-Index 和 AU-Index-delta 都为 0，RTP 时间戳是第一个 AU 的时间戳，
+	   接收端按每个 AU SAMPLES_PER_AU 推算后续 AU 的时间戳。
+	2. 时间戳与推算值相差超过一个 AU（采集中断、时钟跳变）时先发出已聚合的 AU，不把它们放进同一个包。
+	3. 放不进单个包的 AU 分片发送，分片包不与其它 AU 混合。
+	4. 包含完整 AU 或 AU 最后一个分片的包置 marker 位。
+*/
+bool AACSource::HandleFrame(MediaChannelId channel_id, AVFrame frame)
+{
+	uint32_t adts_size = 0;
 	if (has_adts_) {
 		adts_size = ADTS_SIZE;
 	}
 
+	if (frame.size <= adts_size) {
+		return false;
+	}
+
 	uint8_t *frame_buf = frame.buffer.get() + adts_size; 
 	uint32_t frame_size = frame.size - adts_size;
+	if (frame_size > MAX_AU_SIZE) {
+		return false;
+	}
+
+	if (!pending_sizes_.empty()) {
+		uint32_t expected = pending_timestamp_ + (uint32_t)pending_sizes_.size() * SAMPLES_PER_AU;
+		int32_t diff = (int32_t)(frame.timestamp - expected);
+		uint32_t packet_size = AU_HEADERS_LENGTH_SIZE + AU_HEADER_SIZE * ((uint32_t)pending_sizes_.size() + 1)
+			+ (uint32_t)pending_data_.size() + frame_size;
+		if (diff < -(int32_t)SAMPLES_PER_AU || diff > (int32_t)SAMPLES_PER_AU || packet_size > MAX_RTP_PAYLOAD_SIZE) {
+			Flush(channel_id);
+		}
+	}
+
+	if (AU_HEADERS_LENGTH_SIZE + AU_HEADER_SIZE + frame_size > MAX_RTP_PAYLOAD_SIZE) {
+		Flush(channel_id);
+		return SendFragments(channel_id, frame, frame_buf, frame_size);
+	}
+
+	if (pending_sizes_.empty()) {
+		pending_timestamp_ = frame.timestamp;
+		pending_type_ = frame.type;
+	}
+	pending_sizes_.push_back((uint16_t)frame_size);
+	pending_data_.insert(pending_data_.end(), frame_buf, frame_buf + frame_size);
+
+	if (pending_sizes_.size() >= max_aus_) {
+		Flush(channel_id);
+	}
+
+	return true;
+}
 
-	char AU[AU_SIZE] = { 0 };
-	AU[0] = 0x00;
-	AU[1] = 0x10;
-	AU[2] = (frame_size & 0x1fe0) >> 5;
-	AU[3] = (frame_size & 0x1f) << 3;
+/*
+发出已聚合的 AU：AU-headers-length + AU 头 + AU 数据。
+*/
+bool AACSource::Flush(MediaChannelId channel_id)
+{
+	if (pending_sizes_.empty()) {
+		return true;
+	}
 
 	RtpPacket rtp_pkt;
-	rtp_pkt.type = frame.type;
-	rtp_pkt.timestamp = frame.timestamp;
-	rtp_pkt.size = frame_size + 4 + RTP_HEADER_SIZE + AU_SIZE;
-	rtp_pkt.last = 1;
+	uint8_t* payload = rtp_pkt.data.get() + 4 + RTP_HEADER_SIZE;
+	uint32_t count = (uint32_t)pending_sizes_.size();
+	uint32_t headers_bits = count * AU_HEADER_SIZE * 8;
+
+	payload[0] = (uint8_t)(headers_bits >> 8);
+	payload[1] = (uint8_t)(headers_bits & 0xFF);
+	uint8_t* header = payload + AU_HEADERS_LENGTH_SIZE;
+	for (uint32_t n = 0; n < count; n++) {
+		header[0] = (uint8_t)((pending_sizes_[n] & 0x1FE0) >> 5);
+		header[1] = (uint8_t)((pending_sizes_[n] & 0x1F) << 3);
+		header += AU_HEADER_SIZE;
+	}
+	memcpy(header, pending_data_.data(), pending_data_.size());
 
-	rtp_pkt.data.get()[4 + RTP_HEADER_SIZE + 0] = AU[0];
-	rtp_pkt.data.get()[4 + RTP_HEADER_SIZE + 1] = AU[1];
-	rtp_pkt.data.get()[4 + RTP_HEADER_SIZE + 2] = AU[2];
-	rtp_pkt.data.get()[4 + RTP_HEADER_SIZE + 3] = AU[3];
+	rtp_pkt.type = pending_type_;
+	rtp_pkt.timestamp = pending_timestamp_;
+	rtp_pkt.size = 4 + RTP_HEADER_SIZE + (uint32_t)(header - payload) + (uint32_t)pending_data_.size();
+	rtp_pkt.last = 1;
 
-	memcpy(rtp_pkt.data.get()+4+RTP_HEADER_SIZE+AU_SIZE, frame_buf, frame_size);
+	pending_sizes_.clear();
+	pending_data_.clear();
 
 	if (send_frame_callback_) {
-		send_frame_callback_(channel_id, rtp_pkt);
+		return send_frame_callback_(channel_id, rtp_pkt);
+	}
+	return true;
+}
+
+/*
+AU 分片：每个分片都带一个 AU 头，AU-size 为整个 AU 的大小，时间戳相同，只有最后一个分片置 marker 位。
+*/
+bool AACSource::SendFragments(MediaChannelId channel_id, const AVFrame& frame, const uint8_t* data, uint32_t size)
+{
+	uint32_t max_fragment = MAX_RTP_PAYLOAD_SIZE - AU_HEADERS_LENGTH_SIZE - AU_HEADER_SIZE;
+	uint32_t au_size = size;
+
+	while (size > 0) {
+		uint32_t fragment_size = size > max_fragment ? max_fragment : size;
+
+		RtpPacket rtp_pkt;
+		uint8_t* payload = rtp_pkt.data.get() + 4 + RTP_HEADER_SIZE;
+		payload[0] = 0x00;
+		payload[1] = AU_HEADER_SIZE * 8;
+		payload[2] = (uint8_t)((au_size & 0x1FE0) >> 5);
+		payload[3] = (uint8_t)((au_size & 0x1F) << 3);
+		memcpy(payload + AU_HEADERS_LENGTH_SIZE + AU_HEADER_SIZE, data, fragment_size);
+
+		rtp_pkt.type = frame.type;
+		rtp_pkt.timestamp = frame.timestamp;
+		rtp_pkt.size = 4 + RTP_HEADER_SIZE + AU_HEADERS_LENGTH_SIZE + AU_HEADER_SIZE + fragment_size;
+		rtp_pkt.last = (fragment_size == size) ? 1 : 0;
+
+		if (send_frame_callback_ && !send_frame_callback_(channel_id, rtp_pkt)) {
+			return false;
+		}
+
+		data += fragment_size;
+		size -= fragment_size;
 	}
 
 	return true;
@@ -4,6 +4,13 @@
 #ifndef XOP_AAC_SOURCE_H
 #define XOP_AAC_SOURCE_H
 
+/*
+AAC 音频的 RTP 封装（RFC 3640，AAC-hbr 模式）：
+按延迟预算把连续的多个 AU 聚合进一个包（AU-headers-length + 每个 AU 2 字节的 AU 头 + AU 数据），
+超过单包负载的 AU 分片发送，每个分片带一个 AU 头，AU-size 为整个 AU 的大小。
+*/
+
+#include <vector>
 #include "MediaSource.h"
 #include "rtp.h"
 
@@ -22,6 +29,12 @@ public:
     uint32_t GetChannels() const
     { return channels_; }
 
+    // 聚合的延迟预算（毫秒）：第一个 AU 最多等待这么久再发送，0 表示每个 AU 单独发送（默认）
+    void SetMaxLatency(uint32_t latency_ms);
+
+    uint32_t GetMaxLatency() const
+    { return max_latency_ms_; }
+
     virtual std::string GetMediaDescription(uint16_t port=0);
 
     virtual std::string GetAttribute();
@@ -33,12 +46,25 @@ public:
 private:
     AACSource(uint32_t samplerate, uint32_t channels, bool has_adts);
 
+    bool Flush(MediaChannelId channel_id);
+    bool SendFragments(MediaChannelId channel_id, const AVFrame& frame, const uint8_t* data, uint32_t size);
+
     uint32_t samplerate_ = 44100;  
     uint32_t channels_ = 2;         
     bool has_adts_ = true;
 
+    uint32_t max_latency_ms_ = 0;
+    uint32_t max_aus_ = 1;                  // 每个包最多聚合的 AU 数，由延迟预算换算
+    std::vector<uint8_t> pending_data_;     // 等待聚合的 AU 数据（HandleFrame 在 MediaSession 的锁内调用）
+    std::vector<uint16_t> pending_sizes_;
+    uint32_t pending_timestamp_ = 0;        // 第一个等待中的 AU 的时间戳
+    uint8_t pending_type_ = 0;
+
     static const int ADTS_SIZE = 7;
-    static const int AU_SIZE   = 4;
+    static const int AU_HEADERS_LENGTH_SIZE = 2;    // AU-headers-length（以位为单位）
+    static const int AU_HEADER_SIZE = 2;            // sizelength=13 + indexlength=3
+    static const uint32_t MAX_AU_SIZE = 0x1FFF;     // AU-size 只有 13 位
+    static const uint32_t SAMPLES_PER_AU = 1024;    // AAC-LC 每帧的采样数
 };
 
 }
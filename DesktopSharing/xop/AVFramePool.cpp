@@ -0,0 +1,75 @@
+#include "AVFramePool.h"
+#include "net/MemoryManager.h"
+
+using namespace xop;
+
+AVFramePool::AVFramePool()
+{
+
+}
+
+/*
+ⲻ֡ھ̬֮ͷš
+*/
+AVFramePool& AVFramePool::Instance()
+{
+	static AVFramePool* s_pool = new AVFramePool;
+	return *s_pool;
+}
+
+/*
+ͬһ߳ͨʹͬһԴһεļֻԴ仯ʱżҡ
+*/
+AVFramePool::SourceCounter* AVFramePool::GetCounter(const char* source)
+{
+	static thread_local const char* t_source = nullptr;
+	static thread_local SourceCounter* t_counter = nullptr;
+
+	if (source != t_source) {
+		std::lock_guard<std::mutex> locker(mutex_);
+		t_counter = &sources_[source];
+		t_source = source;
+	}
+	return t_counter;
+}
+
+void* AVFramePool::AllocBlock(uint32_t size, const char* source)
+{
+	SourceCounter* counter = GetCounter(source);
+	counter->allocs.fetch_add(1, std::memory_order_relaxed);
+	counter->bytes.fetch_add(size, std::memory_order_relaxed);
+	return xop::Alloc(size);
+}
+
+void AVFramePool::FreeBlock(void* ptr)
+{
+	xop::Free(ptr);
+}
+
+std::shared_ptr<uint8_t> AVFramePool::Wrap(uint8_t* data, uint32_t size, std::function<void(uint8_t*)> release, const char* source)
+{
+	SourceCounter* counter = GetCounter(source);
+	counter->external.fetch_add(1, std::memory_order_relaxed);
+	counter->bytes.fetch_add(size, std::memory_order_relaxed);
+
+	return std::shared_ptr<uint8_t>(data, [release](uint8_t* ptr) {
+		if (release) {
+			release(ptr);
+		}
+	});
+}
+
+std::vector<AVFrameSourceStats> AVFramePool::GetStats()
+{
+	std::vector<AVFrameSourceStats> stats;
+	std::lock_guard<std::mutex> locker(mutex_);
+	for (auto& iter : sources_) {
+		AVFrameSourceStats item;
+		item.source = iter.first;
+		item.allocs = iter.second.allocs.load(std::memory_order_relaxed);
+		item.external = iter.second.external.load(std::memory_order_relaxed);
+		item.bytes = iter.second.bytes.load(std::memory_order_relaxed);
+		stats.push_back(item);
+	}
+	return stats;
+}
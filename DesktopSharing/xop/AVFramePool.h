@@ -0,0 +1,78 @@
+#ifndef XOP_AV_FRAME_POOL_H
+#define XOP_AV_FRAME_POOL_H
+
+/*
+Ƶ֡ MemoryManager 䣨Сּ slab̻߳棩һͷʱ MemoryManager
+һ֡ͬСֱӸã MemoryManager ֱּ֡ malloc/free
+Wrap() ֡ⲿڴ棨Ļһͷʱ release
+ͬһݱݿԾ RTSPRTMP 
+䰴Դַ "ScreenLive""RtmpChunk"ֱʵͳƼ MemoryManager::GetStats()
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xop
+{
+
+struct AVFrameSourceStats
+{
+	std::string source;
+	uint64_t allocs = 0;		// 
+	uint64_t external = 0;		// ⲿڴ֡
+	uint64_t bytes = 0;			// õֽ
+};
+
+class AVFramePool
+{
+public:
+	static AVFramePool& Instance();
+
+	//  size ֽڵĻsource ַ
+	template<typename T = uint8_t>
+	std::shared_ptr<T> Alloc(uint32_t size, const char* source)
+	{
+		return std::shared_ptr<T>((T*)AllocBlock(size, source), [](T* ptr) {
+			AVFramePool::Instance().FreeBlock(ptr);
+		});
+	}
+
+	// ⲿڴ棬һͷʱ release(data)
+	std::shared_ptr<uint8_t> Wrap(uint8_t* data, uint32_t size, std::function<void(uint8_t*)> release, const char* source);
+
+	std::vector<AVFrameSourceStats> GetStats();
+
+private:
+	AVFramePool();
+
+	struct SourceCounter
+	{
+		std::atomic<uint64_t> allocs{ 0 };
+		std::atomic<uint64_t> external{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+	};
+
+	struct SourceLess
+	{
+		bool operator()(const char* a, const char* b) const
+		{ return strcmp(a, b) < 0; }
+	};
+
+	void* AllocBlock(uint32_t size, const char* source);
+	void  FreeBlock(void* ptr);
+	SourceCounter* GetCounter(const char* source);
+
+	std::mutex mutex_;		//  sources_ Ĳͱԭӱ
+	std::map<const char*, SourceCounter, SourceLess> sources_;	// ڵ㲻ƶĵַԻ
+};
+
+}
+
+#endif
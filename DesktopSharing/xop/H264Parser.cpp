@@ -69,4 +69,59 @@ Nal H264Parser::findNal(const uint8_t *data, uint32_t size)
     return nal;
 }
 
+/*
+每次检查 q 处的字节：大于 1 时 q、q+1、q+2 都不可能是 00 00 01 的结尾，直接跳 3 字节；
+等于 1 时检查前两个字节；等于 0 时前进 1 字节。大部分数据按 3 字节步长扫描。
+*/
+const uint8_t* H264Parser::FindStartCode(const uint8_t* begin, const uint8_t* end)
+{
+    if (end - begin < 3) {
+        return end;
+    }
+
+    const uint8_t* q = begin + 2;
+    while (q < end) {
+        if (*q > 1) {
+            q += 3;
+        }
+        else if (*q == 0) {
+            q += 1;
+        }
+        else {
+            if (q[-1] == 0 && q[-2] == 0) {
+                return q - 2;
+            }
+            q += 3;
+        }
+    }
+
+    return end;
+}
 
+/*
+4 字节起始码多出的 0 和 trailing_zero_8bits 都算作前一个 NAL 的末尾 0 字节去掉（NAL 不会以 0 字节结尾）。
+*/
+void H264Parser::SplitNals(const uint8_t* data, uint32_t size, std::vector<NalUnit>& nals)
+{
+    nals.clear();
+
+    const uint8_t* end = data + size;
+    const uint8_t* begin = data;
+    const uint8_t* start_code = FindStartCode(data, end);
+
+    while (true) {
+        const uint8_t* nal_end = start_code;
+        while (nal_end > begin && nal_end[-1] == 0) {
+            nal_end--;
+        }
+        if (nal_end > begin) {
+            nals.push_back(NalUnit{ begin, (uint32_t)(nal_end - begin) });
+        }
+
+        if (start_code == end) {
+            break;
+        }
+        begin = start_code + 3;
+        start_code = FindStartCode(begin, end);
+    }
+}
@@ -3,16 +3,31 @@
 
 #include <cstdint> 
 #include <utility> 
+#include <vector> 
 
 namespace xop
 {
 
 typedef std::pair<uint8_t*, uint8_t*> Nal; // <nal begin, nal end>
 
+// 不含起始码的 NAL 单元（指向原缓冲区）
+struct NalUnit
+{
+    const uint8_t* data;
+    uint32_t size;
+};
+
 class H264Parser
 {
 public:    
     static Nal findNal(const uint8_t *data, uint32_t size);
+
+    // 返回 [begin, end) 中第一个 00 00 01 的位置，没有时返回 end
+    static const uint8_t* FindStartCode(const uint8_t* begin, const uint8_t* end);
+
+    // 按起始码（3 或 4 字节）拆分 Annex B 码流，开头的起始码可有可无，NAL 末尾的 0 字节和空 NAL 被去掉。
+    // H.265 的起始码与 H.264 相同，H265Source 也用它拆分访问单元。
+    static void SplitNals(const uint8_t* data, uint32_t size, std::vector<NalUnit>& nals);
         
 private:
   
@@ -5,10 +5,13 @@
 #define XOP_H264_SOURCE_H
 
 /*
-ʵH.264ƵĻװܣΪRTSP/RTPýĺʵ󲹳ƬͲùܡ
+ʵH.264ƵĻװܣΪRTSP/RTPýĺ
+һʵԪ RFC 6184 Ϊ NALС NAL ۺΪ STAP-A NAL ƬΪ FU-A
 */
 
+#include <vector>
 #include "MediaSource.h"
+#include "H264Parser.h"
 #include "rtp.h"
 
 namespace xop
@@ -40,8 +43,15 @@ public:
 private:
 	H264Source(uint32_t framerate);
 
+	bool SendPacket(MediaChannelId channel_id, const AVFrame& frame, RtpPacket& rtp_pkt, uint32_t payload_size, bool last);
+	bool SendSingle(MediaChannelId channel_id, const AVFrame& frame, const NalUnit& nal, bool last);
+	bool SendAggregate(MediaChannelId channel_id, const AVFrame& frame, size_t begin, size_t end, bool last);	// STAP-Aۺ nals_[begin, end)
+	bool SendFragments(MediaChannelId channel_id, const AVFrame& frame, const NalUnit& nal, bool last);			// FU-A
+
 	// Ĭ֡
 	uint32_t framerate_ = 25;
+
+	std::vector<NalUnit> nals_;	// ǰʵԪֳ NALHandleFrame  MediaSession ڵã
 };
 	
 }
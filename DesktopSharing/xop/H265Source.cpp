@@ -8,7 +8,9 @@
 #endif
 
 #include "H265Source.h"
+#include "H264Parser.h"
 #include <cstdio>
+#include <cstring>
 #include <chrono>
 #if defined(__linux) || defined(__linux__) 
 #include <sys/time.h>
@@ -44,91 +46,198 @@ string H265Source::GetMediaDescription(uint16_t port)
 	
 string H265Source::GetAttribute()
 {
+	if (donl_) {
+		// sprop-max-don-diff 大于 0 时接收端按 DONL/DOND 解析（RFC 7798 7.1）
+		return string("a=rtpmap:96 H265/90000\r\na=fmtp:96 sprop-max-don-diff=1");
+	}
 	return string("a=rtpmap:96 H265/90000");
 }
 
+/*
+按 RFC 7798 把一个访问单元封装为 RTP 包：
+	1. 按起始码拆分出所有 NAL（VPS+SPS+PPS+SEI+IDR 常在同一帧里）。
+	2. 连续的小 NAL 聚合进一个 AP（类型 48）：2 字节负载头 + 每个 NAL 的 [DONL/DOND] + 2 字节长度和内容。
+	   只有一个 NAL 放得下时用单 NAL 单元包。
+	3. 放不下的 NAL 用 FU（类型 49）分片，分片大小均分。
+	4. 只有访问单元的最后一个包置 last（RTP marker 位）。
+启用 DONL 时，单 NAL 包和第一个 FU 分片带 2 字节 DONL，AP 的第一个单元带 DONL、之后的单元带 DOND；
+NAL 按解码顺序发送，DOND 总是 0。
+*/
 bool H265Source::HandleFrame(MediaChannelId channelId, AVFrame frame)
 {
-	uint8_t *frame_buf  = frame.buffer.get();
-	uint32_t frame_size = frame.size;
-
 	if (frame.timestamp == 0) {
 		frame.timestamp = GetTimestamp();
 	}
-        
-	if (frame_size <= MAX_RTP_PAYLOAD_SIZE) {
-		RtpPacket rtp_pkt;
-		rtp_pkt.type = frame.type;
-		rtp_pkt.timestamp = frame.timestamp;
-		rtp_pkt.size = frame_size + 4 + RTP_HEADER_SIZE;
-		rtp_pkt.last = 1;
-
-		memcpy(rtp_pkt.data.get()+4+RTP_HEADER_SIZE, frame_buf, frame_size);
-        
-		if (send_frame_callback_) {
-			if (!send_frame_callback_(channelId, rtp_pkt)) {
-				return false;
-			}          
+
+	H264Parser::SplitNals(frame.buffer.get(), frame.size, nals_);
+
+	// 去掉不足 2 字节 NAL 头的无效 NAL
+	size_t count = 0;
+	for (size_t n = 0; n < nals_.size(); n++) {
+		if (nals_[n].size >= 2) {
+			nals_[count++] = nals_[n];
 		}
-	}	
-	else {	
-		char FU[3] = {0};	
-		char nalUnitType = (frame_buf[0] & 0x7E) >> 1; 
-		FU[0] = (frame_buf[0] & 0x81) | (49<<1); 
-		FU[1] = frame_buf[1]; 
-		FU[2] = (0x80 | nalUnitType); 
-        
-		frame_buf  += 2;
-		frame_size -= 2;
-        
-		while (frame_size + 3 > MAX_RTP_PAYLOAD_SIZE) {
-			RtpPacket rtp_pkt;
-			rtp_pkt.type = frame.type;
-			rtp_pkt.timestamp = frame.timestamp;
-			rtp_pkt.size = 4 + RTP_HEADER_SIZE + MAX_RTP_PAYLOAD_SIZE;
-			rtp_pkt.last = 0;
-
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+4] = FU[0];
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+5] = FU[1];
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+6] = FU[2];
-			memcpy(rtp_pkt.data.get()+4+RTP_HEADER_SIZE+3, frame_buf, MAX_RTP_PAYLOAD_SIZE-3);
-            
-			if (send_frame_callback_) {
-				if (!send_frame_callback_(channelId, rtp_pkt)) {
-					return false;
-				}                
+	}
+	nals_.resize(count);
+
+	uint32_t donl_size = donl_ ? 2 : 0;
+	size_t n = 0;
+	while (n < count) {
+		if (nals_[n].size + donl_size > MAX_RTP_PAYLOAD_SIZE) {
+			if (!SendFragments(channelId, frame, nals_[n], n + 1 == count)) {
+				return false;
 			}
-            
-			frame_buf  += (MAX_RTP_PAYLOAD_SIZE - 3);
-			frame_size -= (MAX_RTP_PAYLOAD_SIZE - 3);
-        
-			FU[2] &= ~0x80;						
+			n += 1;
+			continue;
 		}
-        
-		{
-			RtpPacket rtp_pkt;
-			rtp_pkt.type = frame.type;
-			rtp_pkt.timestamp = frame.timestamp;
-			rtp_pkt.size = 4 + RTP_HEADER_SIZE + 3 + frame_size;
-			rtp_pkt.last = 1;
-
-			FU[2] |= 0x40;
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+4] = FU[0];
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+5] = FU[1];
-			rtp_pkt.data.get()[RTP_HEADER_SIZE+6] = FU[2];
-			memcpy(rtp_pkt.data.get()+4+RTP_HEADER_SIZE+3, frame_buf, frame_size);
-            
-			if (send_frame_callback_) {
-				if (!send_frame_callback_(channelId, rtp_pkt)) {
-					return false;
-				}               
-			}
-		}            
+
+		// 尽量多地把后续 NAL 聚合进同一个 AP
+		size_t end = n + 1;
+		uint32_t ap_size = 2 + donl_size + 2 + nals_[n].size;
+		while (end < count && ap_size + (donl_ ? 1 : 0) + 2 + nals_[end].size <= MAX_RTP_PAYLOAD_SIZE) {
+			ap_size += (donl_ ? 1 : 0) + 2 + nals_[end].size;
+			end += 1;
+		}
+
+		bool ret = (end - n == 1) ? SendSingle(channelId, frame, nals_[n], end == count)
+		                          : SendAggregate(channelId, frame, n, end, end == count);
+		if (!ret) {
+			return false;
+		}
+		n = end;
 	}
 
 	return true;
 }
 
+bool H265Source::SendPacket(MediaChannelId channelId, const AVFrame& frame, RtpPacket& rtp_pkt, uint32_t payload_size, bool last)
+{
+	rtp_pkt.type = frame.type;
+	rtp_pkt.timestamp = frame.timestamp;
+	rtp_pkt.size = 4 + RTP_HEADER_SIZE + payload_size;
+	rtp_pkt.last = last ? 1 : 0;
+
+	if (send_frame_callback_) {
+		return send_frame_callback_(channelId, rtp_pkt);
+	}
+	return true;
+}
+
+/*
+单 NAL 单元包：NAL 头作为负载头，之后是 [DONL] 和 NAL 的其余部分。
+*/
+bool H265Source::SendSingle(MediaChannelId channelId, const AVFrame& frame, const NalUnit& nal, bool last)
+{
+	RtpPacket rtp_pkt;
+	uint8_t* payload = rtp_pkt.data.get() + 4 + RTP_HEADER_SIZE;
+	uint32_t offset = 2;
+
+	payload[0] = nal.data[0];
+	payload[1] = nal.data[1];
+	if (donl_) {
+		payload[2] = (uint8_t)(don_ >> 8);
+		payload[3] = (uint8_t)(don_ & 0xFF);
+		offset += 2;
+	}
+	don_ += 1;
+
+	memcpy(payload + offset, nal.data + 2, nal.size - 2);
+	return SendPacket(channelId, frame, rtp_pkt, offset + nal.size - 2, last);
+}
+
+/*
+AP：负载头的 F 取各 NAL 的 F 位之或，LayerId 和 TID 取各 NAL 的最小值，类型 48。
+*/
+bool H265Source::SendAggregate(MediaChannelId channelId, const AVFrame& frame, size_t begin, size_t end, bool last)
+{
+	RtpPacket rtp_pkt;
+	uint8_t* payload = rtp_pkt.data.get() + 4 + RTP_HEADER_SIZE;
+	uint8_t forbidden = 0, layer_id = 0x3F, tid = 0x07;
+	uint32_t offset = 2;
+
+	for (size_t n = begin; n < end; n++) {
+		const NalUnit& nal = nals_[n];
+		uint8_t nal_layer_id = (uint8_t)(((nal.data[0] & 0x01) << 5) | (nal.data[1] >> 3));
+		uint8_t nal_tid = nal.data[1] & 0x07;
+		forbidden |= nal.data[0] & 0x80;
+		if (nal_layer_id < layer_id) {
+			layer_id = nal_layer_id;
+		}
+		if (nal_tid < tid) {
+			tid = nal_tid;
+		}
+
+		if (donl_) {
+			if (n == begin) {
+				payload[offset] = (uint8_t)(don_ >> 8);
+				payload[offset + 1] = (uint8_t)(don_ & 0xFF);
+				offset += 2;
+			}
+			else {
+				payload[offset] = 0;	// DOND：与前一个 NAL 的 DON 差值减 1
+				offset += 1;
+			}
+		}
+		don_ += 1;
+
+		payload[offset] = (uint8_t)(nal.size >> 8);
+		payload[offset + 1] = (uint8_t)(nal.size & 0xFF);
+		memcpy(payload + offset + 2, nal.data, nal.size);
+		offset += 2 + nal.size;
+	}
+
+	payload[0] = forbidden | (48 << 1) | (layer_id >> 5);
+	payload[1] = (uint8_t)((layer_id << 3) | tid);
+	return SendPacket(channelId, frame, rtp_pkt, offset, last);
+}
+
+/*
+FU：负载头保留原 NAL 头的 F、LayerId 和 TID，类型 49；FU 头携带 S/E 位和原 NAL 类型。
+原 NAL 头不发送，启用 DONL 时只有第一个分片带 DONL。
+*/
+bool H265Source::SendFragments(MediaChannelId channelId, const AVFrame& frame, const NalUnit& nal, bool last)
+{
+	const uint8_t* data = nal.data + 2;
+	uint32_t size = nal.size - 2;
+	uint32_t donl_size = donl_ ? 2 : 0;
+	uint32_t max_fragment = MAX_RTP_PAYLOAD_SIZE - 3 - donl_size;
+	uint32_t num_fragments = (size + max_fragment - 1) / max_fragment;
+
+	uint8_t payload_hdr0 = (nal.data[0] & 0x81) | (49 << 1);
+	uint8_t payload_hdr1 = nal.data[1];
+	uint8_t fu_header = (nal.data[0] >> 1) & 0x3F;
+	uint16_t don = don_;
+	don_ += 1;
+
+	for (uint32_t n = 0; n < num_fragments; n++) {
+		// 剩余数据均分到剩余的分片
+		uint32_t fragment_size = (size + (num_fragments - n) - 1) / (num_fragments - n);
+		bool is_first = (n == 0);
+		bool is_last = (n + 1 == num_fragments);
+
+		RtpPacket rtp_pkt;
+		uint8_t* payload = rtp_pkt.data.get() + 4 + RTP_HEADER_SIZE;
+		uint32_t offset = 3;
+		payload[0] = payload_hdr0;
+		payload[1] = payload_hdr1;
+		payload[2] = fu_header | (is_first ? 0x80 : 0) | (is_last ? 0x40 : 0);
+		if (is_first && donl_) {
+			payload[3] = (uint8_t)(don >> 8);
+			payload[4] = (uint8_t)(don & 0xFF);
+			offset += 2;
+		}
+		memcpy(payload + offset, data, fragment_size);
+
+		if (!SendPacket(channelId, frame, rtp_pkt, offset + fragment_size, last && is_last)) {
+			return false;
+		}
+
+		data += fragment_size;
+		size -= fragment_size;
+	}
+
+	return true;
+}
 
 uint32_t H265Source::GetTimestamp()
 {
@@ -4,7 +4,13 @@
 #ifndef XOP_H265_SOURCE_H
 #define XOP_H265_SOURCE_H
 
+/*
+H.265 视频的 RTP 封装（RFC 7798）：访问单元拆分为 NAL，小 NAL 聚合为 AP，大 NAL 分片为 FU，可选 DONL。
+*/
+
+#include <vector>
 #include "MediaSource.h"
+#include "H264Parser.h"
 #include "rtp.h"
 
 namespace xop
@@ -22,6 +28,10 @@ public:
 	uint32_t GetFramerate() const 
 	{ return framerate_; }
 
+	// 启用 DONL/DOND 字段（SDP 中声明 sprop-max-don-diff），须在生成 SDP 之前设置
+	void SetDonl(bool enable)
+	{ donl_ = enable; }
+
 	virtual std::string GetMediaDescription(uint16_t port=0); 
 
 	virtual std::string GetAttribute(); 
@@ -33,7 +43,16 @@ public:
 private:
 	H265Source(uint32_t framerate);
 
+	bool SendPacket(MediaChannelId channelId, const AVFrame& frame, RtpPacket& rtp_pkt, uint32_t payload_size, bool last);
+	bool SendSingle(MediaChannelId channelId, const AVFrame& frame, const NalUnit& nal, bool last);
+	bool SendAggregate(MediaChannelId channelId, const AVFrame& frame, size_t begin, size_t end, bool last);	// AP，聚合 nals_[begin, end)
+	bool SendFragments(MediaChannelId channelId, const AVFrame& frame, const NalUnit& nal, bool last);			// FU
+
 	uint32_t framerate_ = 25;
+
+	bool donl_ = false;
+	uint16_t don_ = 0;			// 下一个 NAL 的解码顺序号
+	std::vector<NalUnit> nals_;	// 当前访问单元拆分出的 NAL（HandleFrame 在 MediaSession 的锁内调用）
 };
 	
 }
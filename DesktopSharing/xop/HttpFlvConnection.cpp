@@ -178,9 +178,7 @@ int HttpFlvConnection::SendFlvTag(uint8_t type, uint64_t timestamp, std::shared_
 
 	WriteUint32BE(previous_tag_size, payload_size + 11);
 
-	this->Send(tag_header, 11);
-	this->Send(payload.get(), payload_size);
-	this->Send(previous_tag_size, 4);
+	this->Send(tag_header, 11, payload, payload_size, previous_tag_size, 4);
 
 	return 0;
 }
\ No newline at end of file
@@ -22,11 +22,11 @@ void HttpFlvServer::Attach(std::shared_ptr<RtmpServer> rtmp_server)
 	rtmp_server_ = rtmp_server;
 }
 
-TcpConnection::Ptr HttpFlvServer::OnConnect(SOCKET sockfd)
+TcpConnection::Ptr HttpFlvServer::OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler)
 {
 	auto rtmp_server = rtmp_server_.lock();
 	if (rtmp_server) {
-		return std::make_shared<HttpFlvConnection>(rtmp_server, event_loop_->GetTaskScheduler().get(), sockfd);
+		return std::make_shared<HttpFlvConnection>(rtmp_server, task_scheduler, sockfd);
 	}
 	return nullptr;
 }
@@ -18,7 +18,7 @@ public:
 	void Attach(std::shared_ptr<RtmpServer> rtmp_server);
 
 private:
-	TcpConnection::Ptr OnConnect(SOCKET sockfd);
+	TcpConnection::Ptr OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler);
 
 	std::mutex mutex_;
 	std::weak_ptr<RtmpServer> rtmp_server_;
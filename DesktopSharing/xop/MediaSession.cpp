@@ -5,8 +5,6 @@
 #include "RtpConnection.h"
 #include <cstring>
 #include <ctime>
-#include <map>
-#include <forward_list>
 #include "net/Logger.h"
 #include "net/SocketUtil.h"
 
@@ -63,58 +61,18 @@ void MediaSession::AddNotifyDisconnectedCallback(const NotifyDisconnectedCallbac
 }
 
 /*
-添加媒体源并设置其发送回调，当媒体源产生RTP包时，遍历客户端发送数据。
+添加媒体源并设置其发送回调，媒体源产生的RTP包先缓存在 pending_ 中，HandleFrame 处理完一帧后由 Dispatch 统一分发。
+扇出：每个包只有一份数据，所有客户端（不论在哪个调度线程）共享同一个引用计数的缓冲区，
+各连接的 RTP 头（SSRC、序列号、时间戳）生成在自己的头部槽位里，发送时与共享负载分段发送（sendmsg/WSASend）。
 */
 bool MediaSession::AddSource(MediaChannelId channel_id, MediaSource* source) {
 	/*
-	远程监控功能的 RTP 包就是在这里发送的
+	远程监控功能的 RTP 包就是在这里发送的（回调在 HandleFrame 内、mutex_ 持有期间调用）
 	*/
 	source->SetSendFrameCallback([this](MediaChannelId channel_id, RtpPacket pkt) {
-		// 遍历客户端并发送RTP包
-		std::forward_list<std::shared_ptr<RtpConnection>> clients;
-		std::map<int, RtpPacket> packets;
-		{
-			std::lock_guard<std::mutex> lock(map_mutex_);
-			for (auto iter = clients_.begin(); iter != clients_.end();) {
-				auto conn = iter->second.lock();
-				if (conn == nullptr) {
-					clients_.erase(iter++); // 清理无效连接
-				}
-				else {
-					int id = conn->GetId();
-					if (id >= 0) {
-						if (packets.find(id) == packets.end()) {
-							// 复制RTP包（避免修改原始数据）
-							RtpPacket tmp_pkt;
-							memcpy(tmp_pkt.data.get(), pkt.data.get(), pkt.size);
-							tmp_pkt.size = pkt.size;
-							tmp_pkt.last = pkt.last;
-							tmp_pkt.timestamp = pkt.timestamp;
-							tmp_pkt.type = pkt.type;
-							packets.emplace(id, tmp_pkt);
-						}
-						clients.emplace_front(conn);
-					}
-					iter++;
-				}
-			}
-		}
-
-		// 发送RTP包给所有客户端
-		int count = 0;
-		for (auto iter : clients) {
-			int ret = 0;
-			int id = iter->GetId();
-			if (id >= 0) {
-				auto iter2 = packets.find(id);
-				if (iter2 != packets.end()) {
-					count++;
-					ret = iter->SendRtpPacket(channel_id, iter2->second);
-					if (is_multicast_ && ret == 0) {
-						break; // 组播发送失败则终止
-					}
-				}
-			}
+		pending_[channel_id].push_back(std::move(pkt));
+		if (pending_[channel_id].size() >= kMaxRtpBatch) {
+			Dispatch(channel_id);
 		}
 		return true;
 		});
@@ -218,6 +176,7 @@ bool MediaSession::HandleFrame(MediaChannelId channel_id, AVFrame frame)
 
 	if(media_sources_[channel_id]) {
 		media_sources_[channel_id]->HandleFrame(channel_id, frame);
+		Dispatch(channel_id);
 	}
 	else {
 		return false;
@@ -237,6 +196,7 @@ bool MediaSession::AddClient(SOCKET rtspfd, std::shared_ptr<RtpConnection> rtp_c
 	if(iter == clients_.end()) {
 		std::weak_ptr<RtpConnection> rtp_conn_weak_ptr = rtp_conn;
 		clients_.emplace(rtspfd, rtp_conn_weak_ptr);
+		UpdateFanout();
 		for (auto& callback : notify_connected_callbacks_) {
 			callback(session_id_, rtp_conn->GetIp(), rtp_conn->GetPort());
 		}			
@@ -264,6 +224,101 @@ void MediaSession::RemoveClient(SOCKET rtspfd)
 			}				
 		}
 		clients_.erase(iter);
+		UpdateFanout();
+	}
+}
+
+/*
+重建发送路径使用的客户端快照（调用方持有 map_mutex_），按所属调度器分组。
+正在发送的线程仍持有旧快照，用完后自动释放。
+*/
+void MediaSession::UpdateFanout()
+{
+	if (clients_.empty()) {
+		fanout_.reset();
+		return;
+	}
+
+	std::shared_ptr<std::vector<FanoutGroup>> groups(new std::vector<FanoutGroup>());
+	for (auto& iter : clients_) {
+		auto conn = iter.second.lock();
+		if (conn == nullptr) {
+			continue;
+		}
+		TaskScheduler* task_scheduler = conn->GetTaskScheduler();
+		if (task_scheduler == nullptr) {
+			continue;
+		}
+
+		auto group = groups->begin();
+		while (group != groups->end() && group->task_scheduler != task_scheduler) {
+			group++;
+		}
+		if (group == groups->end()) {
+			groups->push_back(FanoutGroup{ task_scheduler, {} });
+			group = groups->end() - 1;
+		}
+		group->clients.push_back(iter.second);
 	}
+	fanout_ = std::move(groups);
 }
 
+/*
+按帧分发（调用方持有 mutex_）：一帧的包打成一个共享的批次，每个调度器只投递一个任务，
+任务在调度线程内按客户端依次调用 SendRtpBatch，同一客户端的包顺序和帧类型处理与逐包投递时相同。
+组播只需发送一次：只投递给第一个调度器，任务内发送给第一个仍然有效的客户端。
+*/
+void MediaSession::Dispatch(MediaChannelId channel_id)
+{
+	if (pending_[channel_id].empty()) {
+		return;
+	}
+
+	size_t num_packets = pending_[channel_id].size();
+	std::shared_ptr<const std::vector<RtpPacket>> packets =
+		std::make_shared<const std::vector<RtpPacket>>(std::move(pending_[channel_id]));
+	pending_[channel_id].clear();
+	pending_[channel_id].reserve(num_packets);
+
+	std::shared_ptr<const std::vector<FanoutGroup>> fanout;
+	{
+		std::lock_guard<std::mutex> lock(map_mutex_);
+		// 清理无效连接
+		for (auto iter = clients_.begin(); iter != clients_.end();) {
+			if (iter->second.expired()) {
+				clients_.erase(iter++);
+				fanout_.reset();
+			}
+			else {
+				iter++;
+			}
+		}
+		if (fanout_ == nullptr) {
+			UpdateFanout();
+		}
+		fanout = fanout_;
+	}
+	if (fanout == nullptr) {
+		return;
+	}
+
+	bool is_multicast = is_multicast_;
+	for (const FanoutGroup& group : *fanout) {
+		const FanoutGroup* group_ptr = &group;
+		bool ret = group.task_scheduler->AddTriggerEvent([fanout, group_ptr, packets, channel_id, is_multicast] {
+			for (auto& weak_conn : group_ptr->clients) {
+				auto conn = weak_conn.lock();
+				if (conn == nullptr) {
+					continue;
+				}
+				conn->SendRtpBatch(channel_id, *packets);
+				if (is_multicast) {
+					break;
+				}
+			}
+			});
+		if (is_multicast && ret) {
+			break;
+		}
+	}
+}
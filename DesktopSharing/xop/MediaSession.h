@@ -27,6 +27,7 @@ MediaSession 类是RTSP流媒体服务器的核心模块，负责管理媒体流
 #include "MediaSource.h"
 #include "net/Socket.h"
 #include "net/RingBuffer.h"
+#include "net/TaskScheduler.h"
 
 namespace xop
 {
@@ -105,6 +106,17 @@ private:
 	friend class MediaSource;
 	friend class RtspServer;
 	MediaSession(std::string url_suffxx);
+	void UpdateFanout();
+	void Dispatch(MediaChannelId channel_id);
+
+	// 同一调度器上的客户端，每帧只向该调度器投递一个任务
+	struct FanoutGroup
+	{
+		TaskScheduler* task_scheduler;
+		std::vector<std::weak_ptr<RtpConnection>> clients;
+	};
+
+	static const size_t kMaxRtpBatch = 128;	// 一帧的包超过该数目时提前分发，限制缓存的包数
 
 	MediaSessionId session_id_ = 0;
 	std::string suffix_;
@@ -118,6 +130,8 @@ private:
 	std::mutex mutex_;
 	std::mutex map_mutex_;
 	std::map<SOCKET, std::weak_ptr<RtpConnection>> clients_;
+	std::shared_ptr<const std::vector<FanoutGroup>> fanout_;	// clients_ 按调度器分组的快照，增删客户端时重建，发送路径只读
+	std::vector<RtpPacket> pending_[MAX_MEDIA_CHANNEL];		// 当前帧已打包、尚未分发的 RTP 包（mutex_ 保护）
 
 	bool is_multicast_ = false;
 	uint16_t multicast_port_[MAX_MEDIA_CHANNEL];
@@ -75,7 +75,7 @@ bool RtmpConnection::OnRead(BufferReader& buffer)
 		}
 
 		if (res_size > 0) {
-			this->Send(res.get(), res_size);
+			this->Send(res, res_size);
 		}
 
 		if (handshake_->IsCompleted()) {
@@ -369,7 +369,7 @@ bool RtmpConnection::Handshake()
 	uint32_t req_size = 1 + 1536; //COC1  
 	std::shared_ptr<char> req(new char[req_size], std::default_delete<char[]>());
 	handshake_->BuildC0C1(req.get(), req_size);
-	this->Send(req.get(), req_size);
+	this->Send(req, req_size);
 	return true;
 }
 
@@ -940,7 +940,7 @@ void RtmpConnection::SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg)
 
 	int size = rtmp_chunk_->CreateChunk(csid, rtmp_msg, buffer.get(), capacity);
 	if (size > 0) {
-		this->Send(buffer.get(), size);
+		this->Send(buffer, size);	// buffer 为本连接独占，按引用发送，不再拷贝
 	}
 }
 
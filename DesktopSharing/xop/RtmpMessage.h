@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include "AVFramePool.h"
 
 namespace xop {
 
@@ -36,7 +37,7 @@ struct RtmpMessage
 		timestamp = 0;
 		extend_timestamp = 0;
 		if (length > 0) {
-			payload.reset(new char[length], std::default_delete<char[]>());
+			payload = AVFramePool::Instance().Alloc<char>(length, "RtmpChunk");
 		}
 	}
 
@@ -257,7 +257,7 @@ int RtmpPublisher::PushVideoFrame(uint8_t *data, uint32_t size)
 		//timestamp_delta = timestamp - video_timestamp_;
 		//video_timestamp_ = timestamp;
 
-		std::shared_ptr<char> payload(new char[size + 4096], std::default_delete<char[]>());
+		std::shared_ptr<char> payload = AVFramePool::Instance().Alloc<char>(size + 4096, "RtmpPublisher");
 		uint32_t payload_size = 0;
 
 		uint8_t *buffer = (uint8_t *)payload.get();
@@ -304,7 +304,7 @@ int RtmpPublisher::PushAudioFrame(uint8_t *data, uint32_t size)
 		//audio_timestamp_ = timestamp;
 		
 		uint32_t payload_size = size + 2;
-		std::shared_ptr<char> payload(new char[size + 2], std::default_delete<char[]>());
+		std::shared_ptr<char> payload = AVFramePool::Instance().Alloc<char>(size + 2, "RtmpPublisher");
 		payload.get()[0] = audio_tag_;
 		payload.get()[1] = 1; // 0: aac sequence header, 1: aac raw data
 		memcpy(payload.get() + 2, data, size);
@@ -34,9 +34,9 @@ std::shared_ptr<RtmpServer> RtmpServer::Create(xop::EventLoop* event_loop)
 	return server;
 }
 
-TcpConnection::Ptr RtmpServer::OnConnect(SOCKET sockfd)
+TcpConnection::Ptr RtmpServer::OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler)
 {
-    return std::make_shared<RtmpConnection>(shared_from_this(), event_loop_->GetTaskScheduler().get(), sockfd);
+    return std::make_shared<RtmpConnection>(shared_from_this(), task_scheduler, sockfd);
 }
 
 void RtmpServer::AddSession(std::string stream_path)
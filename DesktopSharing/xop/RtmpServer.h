@@ -28,7 +28,7 @@ private:
 	bool HasSession(std::string stream_path);
 	bool HasPublisher(std::string stream_path);
 
-    virtual TcpConnection::Ptr OnConnect(SOCKET sockfd);
+    virtual TcpConnection::Ptr OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler);
     
 	xop::EventLoop *event_loop_;
     std::mutex mutex_;
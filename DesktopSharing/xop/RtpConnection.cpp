@@ -6,7 +6,7 @@
 
 RTSP SETUP阶段调用SetupRtpOverUdp()创建UDP套接字
 RTSP PLAY阶段触发Play()激活通道
-发送线程调用SendRtpPacket()，通过sendto发送RTP数据包
+MediaSession 按帧把RTP包投递到连接所属的调度线程，调度线程内调用SendRtpBatch()，UDP 模式按帧用 sendmmsg 批量发送
 异常时调用Teardown()关闭套接字并重置状态
 该实现完整覆盖了RTP传输的核心需求，与文献1描述的RTP包头结构和文献4的RTSP协议交互流程完全吻合
 */
@@ -14,6 +14,14 @@ RTSP PLAY阶段触发Play()激活通道
 #include "RtpConnection.h"
 #include "RtspConnection.h"
 #include "net/SocketUtil.h"
+#include "net/Logger.h"
+#include <mutex>
+#if defined(__linux) || defined(__linux__)
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
 
 using namespace std;
 using namespace xop;
@@ -136,6 +144,7 @@ bool RtpConnection::SetupRtpOverUdp(MediaChannelId channel_id, uint16_t rtp_port
 	}
 
 	SocketUtil::SetSendBufSize(rtpfd_[channel_id], 50*1024);
+	SocketUtil::SetNonBlock(rtcpfd_[channel_id]);	// RtspConnection::HandleRtcp 循环读到 EAGAIN
 
 	peer_rtp_addr_[channel_id].sin_family = AF_INET;
 	peer_rtp_addr_[channel_id].sin_addr.s_addr = peer_addr_.sin_addr.s_addr;
@@ -252,6 +261,7 @@ void RtpConnection::Teardown()
 		for(int chn=0; chn<MAX_MEDIA_CHANNEL; chn++) {
 			media_channel_info_[chn].is_play = false;
 			media_channel_info_[chn].is_record = false;
+			udp_packets_[chn].clear();
 		}
 	}
 }
@@ -299,85 +309,277 @@ void RtpConnection::SetFrameType(uint8_t frame_type)
 }
 
 /*
-填充RTP包头（序列号自增/时间戳转换字节序）
+填充本连接的RTP包头（序列号自增/时间戳转换字节序）。
+RTP 头写入调用方的头部槽位，不改动 RtpPacket 的数据：同一个包的负载由所有连接（跨调度线程）共享，只读。
 */
-void RtpConnection::SetRtpHeader(MediaChannelId channel_id, RtpPacket pkt)
+void RtpConnection::SetRtpHeader(MediaChannelId channel_id, const RtpPacket& pkt, uint8_t* header)
 {
-	if((media_channel_info_[channel_id].is_play || media_channel_info_[channel_id].is_record) && has_key_frame_) {
-		media_channel_info_[channel_id].rtp_header.marker = pkt.last;
-		media_channel_info_[channel_id].rtp_header.ts = htonl(pkt.timestamp);
-		media_channel_info_[channel_id].rtp_header.seq = htons(media_channel_info_[channel_id].packet_seq++);
-		memcpy(pkt.data.get()+4, &media_channel_info_[channel_id].rtp_header, RTP_HEADER_SIZE);
+	media_channel_info_[channel_id].rtp_header.marker = pkt.last;
+	media_channel_info_[channel_id].rtp_header.ts = htonl(pkt.timestamp);
+	media_channel_info_[channel_id].rtp_header.seq = htons(media_channel_info_[channel_id].packet_seq++);
+	memcpy(header, &media_channel_info_[channel_id].rtp_header, RTP_HEADER_SIZE);
+}
+
+TaskScheduler* RtpConnection::GetTaskScheduler() const
+{
+	auto conn = rtsp_connection_.lock();
+	if (!conn) {
+		return nullptr;
 	}
+	return conn->GetTaskScheduler();
 }
 
 /*
-根据传输模式选择TCP/UDP发送，通过任务调度器确保线程安全
+RTP 包的发送入口，在所属调度线程内执行（由 MediaSession 按帧投递的任务调用），逐包处理：
+先标记帧类型（等待关键帧），再按播放状态发送。
+RTP over TCP 的每个包在本连接的栈上槽位里生成 4 字节交织头和 RTP 头并拷贝进写缓冲区，负载按引用追加，与其它连接共享。
+RTP over TCP 每 kMaxTcpBatch 个包在一次加锁内追加到写缓冲区，只尝试发送一次；
+写缓冲区已满时每个包整体丢弃，并跳过这一帧剩下的包（半帧对解码没有用，还占用慢客户端的缓冲区）；
+RTP over UDP 进入 udp_packets_，帧的最后一个包时由 sendmmsg 一次发出。
 */
-int RtpConnection::SendRtpPacket(MediaChannelId channel_id, RtpPacket pkt)
-{    
-	// 这条线跟过来的话，有时候会经过这里，导致直接返回-1。因为rtsp协议相关的工作还没做好
+void RtpConnection::SendRtpBatch(MediaChannelId channel_id, const std::vector<RtpPacket>& packets)
+{
 	if (is_closed_) {
-		return -1;
+		return;
 	}
-   
-	auto conn = rtsp_connection_.lock();
-	if (!conn) {
-		return -1;
+
+	std::shared_ptr<TcpConnection> conn;
+	if (transport_mode_ == RTP_OVER_TCP) {
+		conn = rtsp_connection_.lock();
+		if (!conn) {
+			return;
+		}
 	}
-	RtspConnection *rtsp_conn = (RtspConnection *)conn.get();
-	// 在这里设置 TaskScheduler 中的回调函数
-	bool ret = rtsp_conn->task_scheduler_->AddTriggerEvent([this, channel_id, pkt] {
+
+	uint8_t headers[kMaxTcpBatch][4 + RTP_HEADER_SIZE];
+	SendSlice slices[kMaxTcpBatch];
+	size_t num_slices = 0;
+	uint32_t header_size = 4 + RTP_HEADER_SIZE;
+	bool dropped = false;
+
+	for (const RtpPacket& pkt : packets) {
 		this->SetFrameType(pkt.type);
-		this->SetRtpHeader(channel_id, pkt);
-		if((media_channel_info_[channel_id].is_play || media_channel_info_[channel_id].is_record) && has_key_frame_ ) {            
-			if(transport_mode_ == RTP_OVER_TCP) {
-				SendRtpOverTcp(channel_id, pkt);
-			}
-			else {
-				SendRtpOverUdp(channel_id, pkt);
-			}
-                   
-			//media_channel_info_[channel_id].octetCount  += pkt.size;
-			//media_channel_info_[channel_id].packetCount += 1;
+		if (!(media_channel_info_[channel_id].is_play || media_channel_info_[channel_id].is_record) || !has_key_frame_) {
+			continue;
+		}
+		if (pkt.size < header_size) {
+			continue;
 		}
-	});
 
-	return ret ? 0 : -1;
+		if (transport_mode_ != RTP_OVER_TCP) {
+			SendRtpOverUdp(channel_id, pkt);
+			continue;
+		}
+		if (dropped) {
+			continue;
+		}
+
+		SendSlice& slice = slices[num_slices];
+		this->SetInterleavedHeader(channel_id, pkt, headers[num_slices]);
+		slice.header = (const char*)headers[num_slices];
+		slice.header_size = header_size;
+		slice.payload_size = pkt.size - header_size;
+		if (slice.payload_size > 0) {
+			slice.payload = std::shared_ptr<char>(pkt.data, (char*)pkt.data.get() + header_size);
+		}
+		else {
+			slice.payload.reset();
+		}
+
+		num_slices += 1;
+		if (num_slices == kMaxTcpBatch) {
+			dropped = conn->Send(slices, num_slices) < num_slices;
+			num_slices = 0;
+		}
+	}
+
+	if (num_slices > 0) {
+		conn->Send(slices, num_slices);
+	}
 }
 
 /*
-按RFC 4571规范封装RTP数据（$+通道号+长度）
+按RFC 4571规范封装RTP数据（$+通道号+长度），header 为 4 + RTP_HEADER_SIZE 字节
 */
-int RtpConnection::SendRtpOverTcp(MediaChannelId channel_id, RtpPacket pkt)
+void RtpConnection::SetInterleavedHeader(MediaChannelId channel_id, const RtpPacket& pkt, uint8_t* header)
 {
-	auto conn = rtsp_connection_.lock();
-	if (!conn) {
-		return -1;
-	}
+	header[0] = '$';
+	header[1] = (uint8_t)media_channel_info_[channel_id].rtp_channel;
+	header[2] = (uint8_t)(((pkt.size - 4) & 0xFF00) >> 8);
+	header[3] = (uint8_t)((pkt.size - 4) & 0xFF);
+	this->SetRtpHeader(channel_id, pkt, header + 4);
+}
+
+/*
+直接通过sendto发送裸RTP数据
+*/
+/*
+RTP over UDP 按帧批量发送：包先进入 udp_packets_，帧的最后一个包（或积攒到 kMaxUdpBatch 个）时一次发出，
+大的关键帧不再是每个包一次 sendto。
+*/
+int RtpConnection::SendRtpOverUdp(MediaChannelId channel_id, const RtpPacket& pkt)
+{
+	std::vector<UdpPacket>& packets = udp_packets_[channel_id];
+	packets.push_back(UdpPacket{ pkt, {} });
+	UdpPacket& udp_pkt = packets.back();
+	this->SetRtpHeader(channel_id, pkt, udp_pkt.header);
 
-	uint8_t* rtpPktPtr = pkt.data.get();
-	rtpPktPtr[0] = '$';
-	rtpPktPtr[1] = (char)media_channel_info_[channel_id].rtp_channel;
-	rtpPktPtr[2] = (char)(((pkt.size-4)&0xFF00)>>8);
-	rtpPktPtr[3] = (char)((pkt.size -4)&0xFF);
+	if (udp_pkt.pkt.last || packets.size() >= kMaxUdpBatch) {
+		return this->FlushRtpOverUdp(channel_id);
+	}
 
-	conn->Send((char*)rtpPktPtr, pkt.size);
-	return pkt.size;
+	return 0;
 }
 
 /*
-直接通过sendto发送裸RTP数据
+Linux：每个包用两段 iovec（本连接的 RTP 头 + 共享负载），sendmmsg 一次最多发送 kMaxUdpBatch 个；
+只发出一部分时继续发送剩余的包。EAGAIN/ENOBUFS/EINTR 时把剩余的包留到下一帧再发，
+积压超过 kMaxUdpPending 时丢弃最旧的包；其它错误与原来一样关闭连接。
+开启 UDP GSO 时，连续的等长包（FU-A 分片基本都是满负载）合并为一条消息，附带 UDP_SEGMENT 由内核切分，
+最后一个包可以更短；内核或网卡不支持（EIO/EINVAL/EOPNOTSUPP）时关闭 GSO 后重发。
+其它平台逐个 sendto。
 */
-int RtpConnection::SendRtpOverUdp(MediaChannelId channel_id, RtpPacket pkt)
+int RtpConnection::FlushRtpOverUdp(MediaChannelId channel_id)
 {
-	int ret = sendto(rtpfd_[channel_id], (const char*)pkt.data.get()+4, pkt.size-4, 0,
-					(struct sockaddr *)&(peer_rtp_addr_[channel_id]), sizeof(struct sockaddr_in));
-                   
-	if(ret < 0) {        
+	std::vector<UdpPacket>& packets = udp_packets_[channel_id];
+	size_t sent = 0;
+	int bytes = 0;
+	bool teardown = false;
+
+	while (sent < packets.size()) {
+#if defined(__linux) || defined(__linux__)
+		struct mmsghdr msgs[kMaxUdpBatch];
+		struct iovec iov[kMaxUdpBatch][2];
+		char control[kMaxUdpBatch][CMSG_SPACE(sizeof(uint16_t))];
+		size_t segments[kMaxUdpBatch];	// 每条消息包含的 RTP 包数
+		size_t left = packets.size() - sent;
+		size_t num_packets = left < kMaxUdpBatch ? left : kMaxUdpBatch;
+		unsigned int num_msgs = 0;
+
+		for (size_t i = 0; i < num_packets; ) {
+			size_t seg_size = packets[sent + i].pkt.size - 4;
+			size_t count = 1;
+			size_t total = seg_size;
+			while (udp_gso_ && i + count < num_packets && count < kMaxGsoSegments) {
+				size_t size = packets[sent + i + count].pkt.size - 4;
+				if (size > seg_size || total + size > kMaxGsoBytes) {
+					break;
+				}
+				total += size;
+				count += 1;
+				if (size < seg_size) {
+					break;	// 只有最后一段可以比 gso_size 短
+				}
+			}
+
+			for (size_t k = i; k < i + count; k++) {
+				UdpPacket& udp_pkt = packets[sent + k];
+				iov[k][0].iov_base = udp_pkt.header;
+				iov[k][0].iov_len = RTP_HEADER_SIZE;
+				iov[k][1].iov_base = udp_pkt.pkt.data.get() + 4 + RTP_HEADER_SIZE;
+				iov[k][1].iov_len = udp_pkt.pkt.size - 4 - RTP_HEADER_SIZE;
+			}
+
+			struct mmsghdr& msg = msgs[num_msgs];
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_hdr.msg_name = &peer_rtp_addr_[channel_id];
+			msg.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msg.msg_hdr.msg_iov = iov[i];
+			msg.msg_hdr.msg_iovlen = 2 * count;
+
+			if (count > 1) {
+				uint16_t gso_size = (uint16_t)seg_size;
+				msg.msg_hdr.msg_control = control[num_msgs];
+				msg.msg_hdr.msg_controllen = sizeof(control[num_msgs]);
+				struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg.msg_hdr);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+			}
+
+			segments[num_msgs++] = count;
+			i += count;
+		}
+
+		int ret = sendmmsg(rtpfd_[channel_id], msgs, num_msgs, 0);
+		if (ret > 0) {
+			for (int i = 0; i < ret; i++) {
+				bytes += (int)msgs[i].msg_len;
+				sent += segments[i];
+			}
+			continue;
+		}
+
+		if (ret < 0 && udp_gso_ && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP)) {
+			LOG_INFO("[RtpConnection] UDP GSO send failed (errno %d), falling back to sendmmsg.\n", errno);
+			udp_gso_ = false;
+			continue;
+		}
+
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)) {
+			break;
+		}
+		teardown = true;
+		break;
+#else
+		// 与 Linux 相同，两段缓冲区（本连接的 RTP 头 + 共享负载），不把头部写回共享的包
+		UdpPacket& udp_pkt = packets[sent];
+		WSABUF bufs[2];
+		bufs[0].buf = (char*)udp_pkt.header;
+		bufs[0].len = RTP_HEADER_SIZE;
+		bufs[1].buf = (char*)udp_pkt.pkt.data.get() + 4 + RTP_HEADER_SIZE;
+		bufs[1].len = udp_pkt.pkt.size - 4 - RTP_HEADER_SIZE;
+		DWORD bytes_sent = 0;
+		int ret = WSASendTo(rtpfd_[channel_id], bufs, 2, &bytes_sent, 0,
+						(struct sockaddr *)&(peer_rtp_addr_[channel_id]), sizeof(struct sockaddr_in), NULL, NULL);
+		if (ret != 0) {
+			teardown = true;
+			break;
+		}
+		bytes += (int)bytes_sent;
+		sent += 1;
+#endif
+	}
+
+	packets.erase(packets.begin(), packets.begin() + sent);
+	if (teardown) {
+		packets.clear();
 		Teardown();
 		return -1;
 	}
 
-	return ret;
+	if (packets.size() > kMaxUdpPending) {
+		packets.erase(packets.begin(), packets.begin() + (packets.size() - kMaxUdpPending));
+	}
+
+	return bytes;
+}
+
+/*
+探测一次：能否在 UDP socket 上设置 UDP_SEGMENT（Linux 4.18+）。
+发送时网卡不支持校验和卸载等情况仍可能失败，由 FlushRtpOverUdp 回退。
+*/
+bool RtpConnection::IsUdpGsoSupported()
+{
+	static std::once_flag flag;
+	static bool supported = false;
+
+	std::call_once(flag, [] {
+#if defined(__linux) || defined(__linux__)
+		SOCKET fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd >= 0) {
+			int gso_size = 1400;
+			supported = (setsockopt(fd, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size)) == 0);
+			SocketUtil::Close(fd);
+		}
+#endif
+	});
+
+	return supported;
+}
+
+void RtpConnection::SetUdpGso(bool enable)
+{
+	udp_gso_ = enable && IsUdpGsoSupported();
 }
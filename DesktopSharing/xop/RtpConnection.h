@@ -82,7 +82,12 @@ public:
     void Teardown();    // 关闭连接，释放资源
 
     std::string GetRtpInfo(const std::string& rtsp_url);
-    int SendRtpPacket(MediaChannelId channel_id, RtpPacket pkt);    // 发送 RTP 数据包。
+
+    // RTP over UDP 使用 UDP GSO（UDP_SEGMENT）批量发送等长的包，内核不支持时保持关闭。
+    void SetUdpGso(bool enable);
+    bool IsUdpGso() const
+    { return udp_gso_; }
+    static bool IsUdpGsoSupported();
 
     bool IsClosed() const
     { return is_closed_; }
@@ -96,9 +101,19 @@ private:
     friend class RtspConnection;
     friend class MediaSession;
     void SetFrameType(uint8_t frameType = 0);
-    void SetRtpHeader(MediaChannelId channel_id, RtpPacket pkt);
-    int  SendRtpOverTcp(MediaChannelId channel_id, RtpPacket pkt);
-    int  SendRtpOverUdp(MediaChannelId channel_id, RtpPacket pkt);
+    void SetRtpHeader(MediaChannelId channel_id, const RtpPacket& pkt, uint8_t* header);  // 生成本连接的 RTP 头，写入 header（RTP_HEADER_SIZE 字节）
+    void SetInterleavedHeader(MediaChannelId channel_id, const RtpPacket& pkt, uint8_t* header);  // 4 字节交织头 + RTP 头
+    void SendRtpBatch(MediaChannelId channel_id, const std::vector<RtpPacket>& packets);  // 在所属调度线程内按顺序发送一批包（MediaSession 按帧分发）
+    TaskScheduler* GetTaskScheduler() const;   // 所属 RTSP 连接的调度器，连接已释放时返回 nullptr
+    int  SendRtpOverUdp(MediaChannelId channel_id, const RtpPacket& pkt);
+    int  FlushRtpOverUdp(MediaChannelId channel_id);  // 把积攒的 RTP over UDP 包一次发出（Linux 上为 sendmmsg）
+
+    // 等待批量发送的 UDP 包：RTP 头保存在本连接的槽位里（RtpPacket 的数据由所有连接共享，只读）
+    struct UdpPacket
+    {
+        RtpPacket pkt;
+        uint8_t header[RTP_HEADER_SIZE];
+    };
 
     std::weak_ptr<TcpConnection> rtsp_connection_; // 关联的 RTSP 连接（弱引用）
     std::string rtsp_ip_;                          // RTSP 服务器 IP 地址
@@ -108,6 +123,7 @@ private:
 
     bool is_closed_ = false;                       // 连接是否已关闭
     bool has_key_frame_ = false;                   // 是否包含关键帧（用于视频流）
+    bool udp_gso_ = false;                         // 是否使用 UDP GSO 发送
     uint8_t frame_type_ = 0;                       // 帧类型（如 I/P/B 帧）
 
     uint16_t local_rtp_port_[MAX_MEDIA_CHANNEL];   // 本地 RTP 端口数组（每个通道一个）
@@ -119,6 +135,13 @@ private:
     struct sockaddr_in peer_rtp_addr_[MAX_MEDIA_CHANNEL];       // 对端 RTP 地址
     struct sockaddr_in peer_rtcp_sddr_[MAX_MEDIA_CHANNEL];      // 对端 RTCP 地址
     MediaChannelInfo media_channel_info_[MAX_MEDIA_CHANNEL];    // 每个通道的配置和统计信息
+    std::vector<UdpPacket> udp_packets_[MAX_MEDIA_CHANNEL];     // 一帧内等待批量发送的 RTP over UDP 包
+
+    static const size_t kMaxTcpBatch = 64;        // RTP over TCP 一次追加到写缓冲区的最大包数
+    static const size_t kMaxUdpBatch = 256;       // 每次 sendmmsg 的最大包数，同时也是不等帧结束就发送的阈值
+    static const size_t kMaxUdpPending = 1024;    // 发送失败留待下次重试的包数上限，超过后丢弃最旧的包
+    static const size_t kMaxGsoSegments = 64;     // 一条 GSO 消息的最大分段数（内核 UDP_MAX_SEGMENTS）
+    static const size_t kMaxGsoBytes = 65000;     // 一条 GSO 消息的最大负载（不超过 UDP 数据报上限）
 };
 
 }
@@ -0,0 +1,72 @@
+#include "RtpPacketPool.h"
+#include <new>
+
+using namespace xop;
+
+namespace
+{
+template<typename T>
+struct PacketAllocator
+{
+	using value_type = T;
+
+	PacketAllocator() = default;
+	template<typename U>
+	PacketAllocator(const PacketAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		T* ptr = (T*)xop::Alloc((uint32_t)(n * sizeof(T)));
+		if (ptr == nullptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+
+	void deallocate(T* ptr, size_t)
+	{ xop::Free(ptr); }
+
+	template<typename U>
+	bool operator==(const PacketAllocator<U>&) const
+	{ return true; }
+
+	template<typename U>
+	bool operator!=(const PacketAllocator<U>&) const
+	{ return false; }
+};
+
+struct PacketBuffer
+{
+	PacketBuffer() {}	// 㻺
+
+	uint8_t data[RtpPacketPool::kPacketSize];
+};
+
+// ƿ + ĴСޣڶλ RTP ڵķּ
+const uint32_t kBlockSize = RtpPacketPool::kPacketSize + 64;
+}
+
+/*
+ƿͻһһУָ򻺳ı shared_ptr
+*/
+std::shared_ptr<uint8_t> RtpPacketPool::Alloc()
+{
+	std::shared_ptr<PacketBuffer> buffer = std::allocate_shared<PacketBuffer>(PacketAllocator<PacketBuffer>());
+	return std::shared_ptr<uint8_t>(buffer, buffer->data);
+}
+
+void RtpPacketPool::SetCapacity(uint64_t max_bytes)
+{
+	MemoryManager::Instance().SetCapacity(kBlockSize, max_bytes);
+}
+
+MemoryClassStats RtpPacketPool::GetStats()
+{
+	uint32_t block_size = kBlockSize + MemoryManager::kHeaderSize;
+	for (const MemoryClassStats& stats : MemoryManager::Instance().GetStats()) {
+		if (stats.block_size >= block_size) {
+			return stats;
+		}
+	}
+	return MemoryClassStats();
+}
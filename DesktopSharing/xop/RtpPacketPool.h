@@ -0,0 +1,35 @@
+#ifndef XOP_RTP_PACKET_POOL_H
+#define XOP_RTP_PACKET_POOL_H
+
+/*
+RTP  MemoryManager 䣨RTP ڵķּٵάһء
+RtpPacket  data ͨ std::allocate_shared 䣬üͬһֻһΣ
+һĸ߳ͷţͨǷݵĵ̣߳ͷŻĸ̵߳Ļ棬
+̻߳ԺλĲֿ⣬ɷ RTP ߳ȡء
+*/
+
+#include <cstdint>
+#include <memory>
+#include "net/MemoryManager.h"
+
+namespace xop
+{
+
+class RtpPacketPool
+{
+public:
+	static const uint32_t kPacketSize = 1600;	// RTP СRTP ͷ + չͷ + أ MTU
+
+	// һ kPacketSize ֽڵĻ
+	static std::shared_ptr<uint8_t> Alloc();
+
+	// RTP ڷּֽMemoryManager::SetCapacityĬּͬ
+	static void SetCapacity(uint64_t max_bytes);
+
+	// RTP ڷּͳ
+	static MemoryClassStats GetStats();
+};
+
+}
+
+#endif
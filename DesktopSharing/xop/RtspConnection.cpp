@@ -220,8 +220,14 @@ void RtspConnection::HandleRtcp(BufferReader& buffer)
  
 void RtspConnection::HandleRtcp(SOCKET sockfd)
 {
+	// 读空接收队列：边沿触发模式下不读完就不会再有通知
 	char buf[1024] = {0};
-	if(recv(sockfd, buf, 1024, 0) > 0) {
+	bool alive = false;
+	while(recv(sockfd, buf, 1024, 0) > 0) {
+		alive = true;
+	}
+
+	if(alive) {
 		KeepAlive();
 	}
 }
@@ -466,6 +472,7 @@ void RtspConnection::HandleCmdSetup()
 
 			// 通过 UDP 协议建立 RTP/RTCP 传输通道，核心步骤包括绑定本地端口、配置对端地址及优化缓冲区
 			if(rtp_conn_->SetupRtpOverUdp(channel_id, peer_rtp_port, peer_rtcp_port)) {
+				rtp_conn_->SetUdpGso(rtsp && rtsp->udp_gso_);
 				SOCKET rtcp_fd = rtp_conn_->GetRtcpSocket(channel_id);
 				rtcp_channels_[channel_id].reset(new Channel(rtcp_fd));
 				// HandleRtcp 仅仅保活用，不做任何控制
@@ -77,9 +77,11 @@ int RtspPusher::OpenUrl(std::string url, int msec)
 
 	task_scheduler_ = event_loop_->GetTaskScheduler().get();
 	rtsp_conn_.reset(new RtspConnection(shared_from_this(), task_scheduler_, tcpSocket.GetSocket()));
-    event_loop_->AddTriggerEvent([this]() {
-		rtsp_conn_->SendOptions(RtspConnection::RTSP_PUSHER);
-    });
+	// 在连接所属的调度线程内发送，与该连接的读写回调串行
+	std::shared_ptr<RtspConnection> rtsp_conn = rtsp_conn_;
+	task_scheduler_->AddTriggerEvent([rtsp_conn]() {
+		rtsp_conn->SendOptions(RtspConnection::RTSP_PUSHER);
+	});
 
 	timeout -= (int)timestamp.Elapsed();
 	if (timeout < 0) {
@@ -131,8 +131,8 @@ bool RtspServer::PushFrame(MediaSessionId session_id, MediaChannelId channel_id,
 客户端连接处理 OnConnect
 功能：当新TCP连接到达时，创建 RtspConnection 对象处理RTSP协议。
 */
-TcpConnection::Ptr RtspServer::OnConnect(SOCKET sockfd)
+TcpConnection::Ptr RtspServer::OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler)
 {	
-	return std::make_shared<RtspConnection>(shared_from_this(), event_loop_->GetTaskScheduler().get(), sockfd);
+	return std::make_shared<RtspConnection>(shared_from_this(), task_scheduler, sockfd);
 }
 
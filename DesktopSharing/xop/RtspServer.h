@@ -53,7 +53,7 @@ private:
     MediaSession::Ptr LookMediaSession(MediaSessionId session_id);
     
     // 重写自 TcpServer，当新TCP连接到达时，创建 RtspConnection 对象处理RTSP协议逻辑。
-    virtual TcpConnection::Ptr OnConnect(SOCKET sockfd);
+    virtual TcpConnection::Ptr OnConnect(SOCKET sockfd, TaskScheduler* task_scheduler);
 
     std::mutex mutex_;
     // 存储所有媒体会话，键为会话ID，值为会话对象的智能指针。
@@ -5,6 +5,7 @@
 #define XOP_MEDIA_H
 
 #include <memory>
+#include "AVFramePool.h"
 
 namespace xop
 {
@@ -30,14 +31,30 @@ enum FrameType
 
 struct AVFrame
 {	
-	AVFrame(uint32_t size = 0)
-		:buffer(new uint8_t[size + 1], std::default_delete< uint8_t[]>())
+	/* 从 AVFramePool 分配，source 为统计用的来源（字符串常量） */
+	AVFrame(uint32_t size = 0, const char* source = "AVFrame")
+		:buffer(AVFramePool::Instance().Alloc(size + 1, source))
 	{
 		this->size = size;
 		type = 0;
 		timestamp = 0;
 	}
 
+	/* 使用已有的缓冲区，不分配不拷贝 */
+	AVFrame(std::shared_ptr<uint8_t> data, uint32_t size)
+		:buffer(std::move(data))
+	{
+		this->size = size;
+		type = 0;
+		timestamp = 0;
+	}
+
+	/* 引用外部内存（如编码器的输出），最后一个引用释放时调用 release */
+	static AVFrame Wrap(uint8_t* data, uint32_t size, std::function<void(uint8_t*)> release, const char* source)
+	{
+		return AVFrame(AVFramePool::Instance().Wrap(data, size, std::move(release), source), size);
+	}
+
 	std::shared_ptr<uint8_t> buffer; /* 帧数据 */
 	uint32_t size;				     /* 帧大小 */
 	uint8_t  type;				     /* 帧类型 */	
@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <cstdint>
+#include "RtpPacketPool.h"
 
 #define RTP_HEADER_SIZE        12      // RTP标准头部长度
 #define MAX_RTP_PAYLOAD_SIZE   1420    // 有效载荷最大尺寸（考虑MTU避免分片）	1460->1500-20-12-8
@@ -75,11 +76,11 @@ struct MediaChannelInfo
 // RTP数据包结构体
 struct RtpPacket 
 {
-	RtpPacket() : data(new uint8_t[1600], std::default_delete<uint8_t[]>()) {
+	RtpPacket() : data(RtpPacketPool::Alloc()) {
 		type = 0;  // 初始化类型
 	}
 
-	std::shared_ptr<uint8_t> data;  // 数据缓冲区（智能指针管理）
+	std::shared_ptr<uint8_t> data;  // 数据缓冲区（RtpPacketPool::kPacketSize 字节，由 RtpPacketPool 从 MemoryManager 分配）
 	uint32_t size;                  // 数据实际大小
 	uint32_t timestamp;             // 时间戳
 	uint8_t  type;                  // 数据类型（可能用于区分音视频）
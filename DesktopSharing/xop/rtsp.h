@@ -56,6 +56,10 @@ public:
 	virtual std::string GetVersion()
 	{ return version_; }
 
+	// RTP over UDP 客户端是否使用 UDP GSO 发送（仅 Linux，内核不支持时自动关闭）。
+	virtual void SetUdpGso(bool enable)
+	{ udp_gso_ = enable; }
+
 	// 返回完整的RTSP URL，用于日志或客户端交互。
 	virtual std::string GetRtspUrl()
 	{ return rtsp_url_info_.url; }
@@ -106,6 +110,7 @@ protected:
 	{ return nullptr; }
 
 	bool has_auth_info_ = false;		// 标记是否启用认证（true 表示启用）。
+	bool udp_gso_ = false;				// RTP over UDP 是否使用 UDP GSO。
 	std::string realm_;					// 认证域（用于HTTP Digest认证）。
 	std::string username_;				// 认证用户名。
 	std::string password_;				// 认证密码。